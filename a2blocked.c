@@ -1,7 +1,13 @@
 #include <string.h>
 
-#include <a2blocked.h>
-#include "uarray2b.h"
+#include "a2blocked.h"
+#include "uarray2b_impl.h"
+#include "a2parallel.h"
+#include "cacheinfo.h"
+
+const Except_T A2Blocked_Bad_blocksize = {
+        "Blocksize must be positive or A2_BLOCKSIZE_L1, _L2 or _LLC"
+};
 
 // define a private version of each function in A2Methods_T that we implement
 
@@ -12,8 +18,15 @@ static A2 new(int width, int height, int size)
         return UArray2b_new_64K_block(width, height, size);
 }
 
+/* a blocksize of A2_BLOCKSIZE_L1, _L2 or _LLC picks one for that cache */
 static A2 new_with_blocksize(int width, int height, int size, int blocksize)
 {
+        if (blocksize == 0 || blocksize < A2_BLOCKSIZE_LLC) {
+                RAISE(A2Blocked_Bad_blocksize);
+        }
+        if (blocksize < 0) {
+                blocksize = CacheInfo_blocksize(-blocksize, size);
+        }
         return UArray2b_new(width, height, size, blocksize);
 }
 
@@ -44,6 +57,12 @@ static A2Methods_Object *at(A2 array2, int i, int j)
         return UArray2b_at(array2, i, j);
 }
 
+static A2Methods_Object *block_span(A2 array2, int bx, int by, int *stride,
+                                    int *width, int *height)
+{
+        return UArray2b_block(array2, bx, by, stride, width, height);
+}
+
 typedef void applyfun(int i, int j, UArray2b_T array2b, void *elem, void *cl);
 
 static void map_block_major(A2 array2, A2Methods_applyfun apply, void *cl)
@@ -72,6 +91,62 @@ static void small_map_block_major(A2 a2, A2Methods_smallapplyfun apply,
         UArray2b_map(a2, apply_small, &mycl);
 }
 
+static void map_region(A2Methods_view view, A2Methods_applyfun apply,
+                       void *cl)
+{
+        UArray2b_map_region(view.parent, view.x, view.y, view.width,
+                            view.height, (applyfun *) apply, cl);
+}
+
+static void small_map_region(A2Methods_view view,
+                             A2Methods_smallapplyfun apply, void *cl)
+{
+        struct small_closure mycl = { apply, cl };
+        UArray2b_map_region(view.parent, view.x, view.y, view.width,
+                            view.height, apply_small, &mycl);
+}
+
+/* map_parallel hands out blocks, numbered in the order they're stored */
+struct parallel_closure {
+        UArray2b_T array2b;
+        A2Methods_applyfun *apply;
+};
+
+static void map_one_block(int block, void *workercl, void *vcl)
+{
+        struct parallel_closure *cl = vcl;
+        UArray2b_T a = cl->array2b;
+        int bx = block % a->blockswide;
+        int by = block / a->blockswide;
+        int bw = UArray2b_blockwidth(a, bx);
+        int bh = UArray2b_blockheight(a, by);
+        char *elem = a->elems + UArray2b_blockstart(a, bx, by) * a->size;
+
+        for (int r = 0; r < bh; r++) {
+                for (int c = 0; c < bw; c++, elem += a->size) {
+                        cl->apply(bx * a->blocksize + c, 
+                                  by * a->blocksize + r, a, elem, workercl);
+                }
+        }
+}
+
+static void map_parallel(A2 array2, int nthreads, A2Methods_applyfun apply,
+                         A2Methods_workerclfun *worker_cl, void *cl)
+{
+        UArray2b_T a = array2;
+        struct parallel_closure mycl = { a, apply };
+        A2Parallel_run(nthreads, a->blockswide * a->blockshigh, 
+                       map_one_block, worker_cl, cl, &mycl);
+}
+
+static void small_map_parallel(A2 a2, int nthreads,
+                               A2Methods_smallapplyfun apply,
+                               A2Methods_workerclfun *worker_cl, void *cl)
+{
+        A2Parallel_small_map(map_parallel, a2, nthreads, apply, worker_cl,
+                             cl);
+}
+
 static struct A2Methods_T uarray2_methods_blocked_struct = {
         new,
         new_with_blocksize,
@@ -89,6 +164,12 @@ static struct A2Methods_T uarray2_methods_blocked_struct = {
         NULL,                   // small_map_col_major
         small_map_block_major,
         small_map_block_major,  // small_map_default
+        map_parallel,
+        small_map_parallel,
+        NULL,                   // row_span
+        block_span,
+        map_region,
+        small_map_region,
 };
 
 // finally the payoff: here is the exported pointer to the struct
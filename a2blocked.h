@@ -0,0 +1,17 @@
+#ifndef A2BLOCKED_INCLUDED
+#define A2BLOCKED_INCLUDED
+
+#include "a2methods.h"
+#include "except.h"
+
+/* Methods suite backed by UArray2b, with block-major mapping */
+extern A2Methods_T uarray2_methods_blocked;
+
+/*
+ * Its new_with_blocksize takes a blocksize greater than 0, or one of
+ * A2_BLOCKSIZE_L1, _L2 or _LLC (-1, -2 and -3, from cacheinfo.h) to size
+ * the blocks for that cache. Anything else raises A2Blocked_Bad_blocksize
+ */
+extern const Except_T A2Blocked_Bad_blocksize;
+
+#endif
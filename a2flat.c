@@ -0,0 +1,187 @@
+#include <stddef.h>
+
+#include "assert.h"
+#include "a2flat.h"
+#include "uarray2f_impl.h"
+#include "a2parallel.h"
+
+/************************************************/
+/* Define a private version of each function in */
+/* A2Methods_T that we implement.               */
+/************************************************/
+typedef A2Methods_UArray2 A2;
+typedef void UArray2f_applyfun(int i, int j,
+                                UArray2f_T array2f, void *elem, void *cl);
+
+static A2 new(int width, int height, int size)
+{
+        return UArray2f_new(width, height, size);
+}
+
+static A2 new_with_blocksize(int width, int height, int size,
+                                            int blocksize)
+{
+        (void) blocksize;
+        return UArray2f_new(width, height, size);
+}
+
+static void a2free(A2 * array2p)
+{
+        UArray2f_free((UArray2f_T *) array2p);
+}
+
+static int width(A2 array2)
+{
+        return UArray2f_width(array2);
+}
+static int height(A2 array2)
+{
+        return UArray2f_height(array2);
+}
+static int size(A2 array2)
+{
+        return UArray2f_size(array2);
+}
+
+static int blocksize(A2 array2)
+{
+        (void) array2;
+        return 1;
+}
+
+
+static A2Methods_Object *at(A2 array2, int i, int j)
+{
+        return UArray2f_at(array2, i, j);
+}
+
+static A2Methods_Object *row_span(A2 array2, int j, int *length)
+{
+        UArray2f_T a = array2;
+        assert(j >= 0 && j < a->height);
+        *length = a->width;
+        return UArray2f_rowstart(a, j);
+}
+
+static void map_row_major(A2Methods_UArray2 uarray2,
+                          A2Methods_applyfun apply,
+                          void *cl)
+{
+        UArray2f_map_row_major(uarray2, (UArray2f_applyfun*)apply, cl);
+}
+
+static void map_col_major(A2Methods_UArray2 uarray2,
+                          A2Methods_applyfun apply,
+                          void *cl)
+{
+        UArray2f_map_col_major(uarray2, (UArray2f_applyfun*)apply, cl);
+}
+
+struct small_closure {
+        A2Methods_smallapplyfun *apply;
+        void                    *cl;
+};
+
+static void apply_small(int i, int j, UArray2f_T uarray2f,
+                        void *elem, void *vcl)
+{
+        struct small_closure *cl = vcl;
+        (void)i;
+        (void)j;
+        (void)uarray2f;
+        cl->apply(elem, cl->cl);
+}
+
+static void small_map_row_major(A2Methods_UArray2        a2,
+                                A2Methods_smallapplyfun  apply,
+                                void *cl)
+{
+        struct small_closure mycl = { apply, cl };
+        UArray2f_map_row_major(a2, apply_small, &mycl);
+}
+
+static void small_map_col_major(A2Methods_UArray2        a2,
+                                A2Methods_smallapplyfun  apply,
+                                void *cl)
+{
+        struct small_closure mycl = { apply, cl };
+        UArray2f_map_col_major(a2, apply_small, &mycl);
+}
+
+static void map_region(A2Methods_view view, A2Methods_applyfun apply,
+                       void *cl)
+{
+        UArray2f_map_region(view.parent, view.x, view.y, view.width,
+                            view.height, (UArray2f_applyfun*)apply, cl);
+}
+
+static void small_map_region(A2Methods_view view,
+                             A2Methods_smallapplyfun apply, void *cl)
+{
+        struct small_closure mycl = { apply, cl };
+        UArray2f_map_region(view.parent, view.x, view.y, view.width,
+                            view.height, apply_small, &mycl);
+}
+
+/* map_parallel hands out whole rows, one task per row */
+struct parallel_closure {
+        UArray2f_T array2f;
+        A2Methods_applyfun *apply;
+};
+
+static void map_row(int j, void *workercl, void *vcl)
+{
+        struct parallel_closure *cl = vcl;
+        UArray2f_T a = cl->array2f;
+        char *elem = UArray2f_rowstart(a, j);
+        for (int i = 0; i < a->width; i++, elem += a->size) {
+                cl->apply(i, j, a, elem, workercl);
+        }
+}
+
+static void map_parallel(A2Methods_UArray2 uarray2, int nthreads,
+                         A2Methods_applyfun apply,
+                         A2Methods_workerclfun *worker_cl, void *cl)
+{
+        struct parallel_closure mycl = { uarray2, apply };
+        A2Parallel_run(nthreads, UArray2f_height(uarray2), map_row,
+                       worker_cl, cl, &mycl);
+}
+
+static void small_map_parallel(A2Methods_UArray2 a2, int nthreads,
+                               A2Methods_smallapplyfun apply,
+                               A2Methods_workerclfun *worker_cl, void *cl)
+{
+        A2Parallel_small_map(map_parallel, a2, nthreads, apply, worker_cl,
+                             cl);
+}
+
+
+static struct A2Methods_T uarray2_methods_flat_struct = {
+        new,
+        new_with_blocksize,
+        a2free,
+        width,
+        height,
+        size,
+        blocksize,                // blocksize
+        at,
+        map_row_major,
+        map_col_major,
+        NULL,                    // map block major
+        map_row_major,           // map_default
+        small_map_row_major,
+        small_map_col_major,
+        NULL,                    //small_map_block_major,
+        small_map_row_major,     // small_map_default
+        map_parallel,
+        small_map_parallel,
+        row_span,
+        NULL,                    // block_span
+        map_region,
+        small_map_region,
+};
+
+// finally the payoff: here is the exported pointer to the struct
+
+A2Methods_T uarray2_methods_flat = &uarray2_methods_flat_struct;
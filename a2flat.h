@@ -0,0 +1,11 @@
+#ifndef A2FLAT_INCLUDED
+#define A2FLAT_INCLUDED
+#include "a2methods.h"
+
+/*
+ * Methods suite backed by UArray2f: the same row- and column-major
+ * mappings as uarray2_methods_plain, but every element sits in one slab
+ */
+extern A2Methods_T uarray2_methods_flat;
+
+#endif
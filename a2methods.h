@@ -0,0 +1,135 @@
+#ifndef A2METHODS_INCLUDED
+#define A2METHODS_INCLUDED
+
+/*
+ * Methods suite for polymorphic two-dimensional arrays, as supplied
+ * for the assignment, kept here so the suite can grow entries of its
+ * own: spans, parallel maps and maps over part of an array.
+ *
+ * An A2Methods_T is a pointer to a struct of function pointers. Each
+ * representation (uarray2_methods_plain, _flat, _blocked, _morton)
+ * exports one, and clients call through it without knowing which
+ * representation they have. A NULL entry means the representation
+ * doesn't offer that mapping.
+ */
+
+typedef void *A2Methods_UArray2;    /* an unknown sort of array */
+typedef void A2Methods_Object;      /* an unknown sort of element */
+
+/* apply function for the full maps: column i, row j, the array, a
+   pointer to the element, and the client's closure */
+typedef void A2Methods_applyfun(int i, int j, A2Methods_UArray2 array2,
+                                A2Methods_Object *ptr, void *cl);
+typedef void A2Methods_mapfun(A2Methods_UArray2 array2,
+                              A2Methods_applyfun apply, void *cl);
+
+/* apply function for the small maps, which pass only the element */
+typedef void A2Methods_smallapplyfun(A2Methods_Object *ptr, void *cl);
+typedef void A2Methods_smallmapfun(A2Methods_UArray2 a2,
+                                   A2Methods_smallapplyfun f, void *cl);
+
+/*
+ * A view is the width x height rectangle of parent whose top left element
+ * is (x, y). It shares the parent's elements and owns nothing, so it is
+ * passed around by value and never freed. The region maps visit just the
+ * elements of a view, in an order that suits the representation, and give
+ * apply their column and row relative to the view (its top left element
+ * is (0, 0)) along with the parent array
+ */
+typedef struct A2Methods_view {
+        A2Methods_UArray2 parent;
+        int x, y;
+        int width, height;
+} A2Methods_view;
+
+typedef void A2Methods_regionmapfun(A2Methods_view view,
+                                    A2Methods_applyfun apply, void *cl);
+typedef void A2Methods_smallregionmapfun(A2Methods_view view,
+                                         A2Methods_smallapplyfun f,
+                                         void *cl);
+
+/*
+ * The parallel maps visit every element exactly once, spread over
+ * nthreads threads (nthreads <= 0 means one per online CPU), and return
+ * when all of them are done. The order of visits is unspecified, and
+ * elements are visited concurrently.
+ *
+ * Before anything is visited, worker_cl(w, cl) is called once for each
+ * worker w = 0 .. nthreads - 1, on the calling thread. Whatever it
+ * returns is the closure that worker passes to apply, so each worker can
+ * accumulate into state nobody else touches. If worker_cl is NULL, every
+ * worker passes cl itself, and apply must then be safe to run on several
+ * threads at once.
+ */
+typedef void *A2Methods_workerclfun(int worker, void *cl);
+typedef void A2Methods_parallelmapfun(A2Methods_UArray2 array2,
+                                      int nthreads,
+                                      A2Methods_applyfun apply,
+                                      A2Methods_workerclfun *worker_cl,
+                                      void *cl);
+typedef void A2Methods_smallparallelmapfun(A2Methods_UArray2 a2,
+                                           int nthreads,
+                                           A2Methods_smallapplyfun f,
+                                           A2Methods_workerclfun *worker_cl,
+                                           void *cl);
+
+typedef const struct A2Methods_T {
+        /* creates a distinct 2D array of memory cells, each of the given
+           'size'; each cell is uninitialized; if the blocksize parameter
+           is provided it is a hint for best performance */
+        A2Methods_UArray2 (*new)(int width, int height, int size);
+        A2Methods_UArray2 (*new_with_blocksize)(int width, int height,
+                                                int size, int blocksize);
+
+        /* frees *array2p and overwrites the pointer with NULL */
+        void (*free)(A2Methods_UArray2 *array2p);
+
+        /* observe properties of the array */
+        int (*width)(A2Methods_UArray2 array2);
+        int (*height)(A2Methods_UArray2 array2);
+        int (*size)(A2Methods_UArray2 array2);
+        int (*blocksize)(A2Methods_UArray2 array2);  /* 1 if not blocked */
+
+        /* returns a pointer to the object in column i, row j (checked
+           runtime error if i or j is out of bounds) */
+        A2Methods_Object *(*at)(A2Methods_UArray2 array2, int i, int j);
+
+        /* mapping functions; each may be NULL */
+        A2Methods_mapfun *map_row_major;
+        A2Methods_mapfun *map_col_major;
+        A2Methods_mapfun *map_block_major;
+        A2Methods_mapfun *map_default;    /* best map for locality */
+
+        /* mapping functions that pass only the element; may be NULL */
+        A2Methods_smallmapfun *small_map_row_major;
+        A2Methods_smallmapfun *small_map_col_major;
+        A2Methods_smallmapfun *small_map_block_major;
+        A2Methods_smallmapfun *small_map_default;
+
+        /* the course's struct ends here. Entries of our own only ever
+           go after it, newest last, so code compiled against the
+           course's pnm.h still finds every entry where it expects */
+
+        /* multithreaded mapping, as described above; may be NULL */
+        A2Methods_parallelmapfun *map_parallel;
+        A2Methods_smallparallelmapfun *small_map_parallel;
+
+        /* spans of elements that lie next to each other in memory, for
+           copying or handing to I/O in one go; each may be NULL.
+           row_span returns the first element of row j and sets *length
+           to the number in the row. block_span returns the top left
+           element of block (bx, by), and sets *stride to the bytes from
+           one of its rows to the next and *width and *height to its
+           extent, clipped at the edges of the array */
+        A2Methods_Object *(*row_span)(A2Methods_UArray2 array2, int j,
+                                      int *length);
+        A2Methods_Object *(*block_span)(A2Methods_UArray2 array2, int bx,
+                                        int by, int *stride, int *width,
+                                        int *height);
+
+        /* mapping over a view, as described above; may be NULL */
+        A2Methods_regionmapfun *map_region;
+        A2Methods_smallregionmapfun *small_map_region;
+} *A2Methods_T;
+
+#endif
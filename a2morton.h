@@ -0,0 +1,11 @@
+#ifndef A2MORTON_INCLUDED
+#define A2MORTON_INCLUDED
+#include "a2methods.h"
+
+/*
+ * Methods suite backed by UArray2m: elements are stored and mapped in
+ * Z-order, which behaves like blocking at every block size at once
+ */
+extern A2Methods_T uarray2_methods_morton;
+
+#endif
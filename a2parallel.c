@@ -0,0 +1,189 @@
+/*
+ *     a2parallel.c
+ *
+ *     locality
+ *
+ *     This is the implementation file for our A2Parallel interface.
+ *
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "assert.h"
+#include "mem.h"
+#include "a2parallel.h"
+#include "threadpool.h"
+
+struct run {
+        A2Parallel_taskfun *task;
+        void *cl;
+        void **workercls;       /* indexed by worker number */
+};
+
+static void run_task(int task, int worker, void *cl)
+{
+        struct run *run = cl;
+        run->task(task, run->workercls[worker], run->cl);
+}
+
+/* the same count Threadpool_new settles on */
+static int thread_count(int nthreads)
+{
+        if (nthreads > 0) {
+                return nthreads;
+        }
+        long ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+        return ncpus > 0 ? ncpus : 1;
+}
+
+/*
+ * Starting and joining threads costs more than a small map, so pools are
+ * kept for reuse, one list entry per pool. A run takes an idle pool of
+ * the size it wants, or starts one if there isn't any (the first run of
+ * that size, or others of that size running at once), and hands it back
+ * idle when it is done. Whatever is idle at exit is freed then.
+ */
+struct cached {
+        int nthreads;
+        bool busy;
+        Threadpool_T pool;
+        struct cached *link;
+};
+
+static pthread_mutex_t cache_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct cached *cache = NULL;
+
+/* frees the idle pools, and reports whether any were busy */
+static bool free_idle(void)
+{
+        bool busy = false;
+        pthread_mutex_lock(&cache_lock);
+        struct cached **pp = &cache;
+        while (*pp != NULL) {
+                struct cached *c = *pp;
+                if (c->busy) {
+                        busy = true;
+                        pp = &c->link;
+                } else {
+                        *pp = c->link;
+                        Threadpool_free(&c->pool);
+                        FREE(c);
+                }
+        }
+        pthread_mutex_unlock(&cache_lock);
+        return busy;
+}
+
+static void free_at_exit(void)
+{
+        (void)free_idle();
+}
+
+static struct cached *take_pool(int nthreads)
+{
+        static bool registered = false;
+        struct cached *c;
+        pthread_mutex_lock(&cache_lock);
+        for (c = cache; c != NULL; c = c->link) {
+                if (!c->busy && c->nthreads == nthreads) {
+                        break;
+                }
+        }
+        if (c == NULL) {
+                NEW(c);
+                c->nthreads = nthreads;
+                c->pool = Threadpool_new(nthreads, false);
+                c->link = cache;
+                cache = c;
+                if (!registered) {
+                        atexit(free_at_exit);
+                        registered = true;
+                }
+        }
+        c->busy = true;
+        pthread_mutex_unlock(&cache_lock);
+        return c;
+}
+
+static void give_back(struct cached *c)
+{
+        pthread_mutex_lock(&cache_lock);
+        c->busy = false;
+        pthread_mutex_unlock(&cache_lock);
+}
+
+void A2Parallel_shutdown(void)
+{
+        bool busy = free_idle();
+        assert(!busy);
+}
+
+void A2Parallel_run(int nthreads, int ntasks, A2Parallel_taskfun *task,
+                    A2Methods_workerclfun *worker_cl, void *client_cl,
+                    void *cl)
+{
+        assert(task != NULL && ntasks >= 0);
+        nthreads = thread_count(nthreads);
+
+        struct run run = { task, cl, NULL };
+        run.workercls = ALLOC(nthreads * sizeof(void *));
+        for (int w = 0; w < nthreads; w++) {
+                run.workercls[w] = worker_cl != NULL ? worker_cl(w, client_cl)
+                                                     : client_cl;
+        }
+
+        struct cached *c = take_pool(nthreads);
+        Threadpool_run(c->pool, ntasks, run_task, &run);
+        give_back(c);
+        FREE(run.workercls);
+}
+
+struct small_closure {
+        A2Methods_smallapplyfun *apply;
+        void *cl;
+};
+
+struct small_map {
+        A2Methods_smallapplyfun *apply;
+        A2Methods_workerclfun *worker_cl;
+        void *cl;
+        struct small_closure *closures;     /* one per worker */
+};
+
+static void *small_worker_cl(int worker, void *cl)
+{
+        struct small_map *map = cl;
+        struct small_closure *mine = &map->closures[worker];
+        mine->apply = map->apply;
+        mine->cl = map->worker_cl != NULL ? map->worker_cl(worker, map->cl)
+                                          : map->cl;
+        return mine;
+}
+
+static void apply_small(int i, int j, A2Methods_UArray2 array2,
+                        A2Methods_Object *elem, void *vcl)
+{
+        struct small_closure *cl = vcl;
+        (void)i;
+        (void)j;
+        (void)array2;
+        cl->apply(elem, cl->cl);
+}
+
+void A2Parallel_small_map(A2Methods_parallelmapfun *map_parallel,
+                          A2Methods_UArray2 a2, int nthreads,
+                          A2Methods_smallapplyfun apply,
+                          A2Methods_workerclfun *worker_cl, void *cl)
+{
+        assert(map_parallel != NULL && apply != NULL);
+        nthreads = thread_count(nthreads);
+
+        struct small_map map = { apply, worker_cl, cl, NULL };
+        map.closures = ALLOC(nthreads * sizeof(struct small_closure));
+        map_parallel(a2, nthreads, apply_small, small_worker_cl, &map);
+        FREE(map.closures);
+}
@@ -0,0 +1,74 @@
+/*
+ *     a2parallel.h
+ *
+ *     locality
+ *
+ *     This is the header file for the A2Parallel interface, the shared
+ *     machinery behind the map_parallel and small_map_parallel entries
+ *     of the methods suites. A suite only has to say how its array
+ *     splits into numbered tasks and how to visit one task.
+ *
+ */
+
+#ifndef A2PARALLEL_INCLUDED
+#define A2PARALLEL_INCLUDED
+
+#include "a2methods.h"
+
+/* visits every element of task number task, passing workercl to apply */
+typedef void A2Parallel_taskfun(int task, void *workercl, void *cl);
+
+
+/**********A2Parallel_run********
+ *
+ * Runs tasks 0 .. ntasks - 1 on nthreads threads
+ * Inputs: number of threads (<= 0 for one per CPU), number of tasks,
+ *      the task function, the client's worker_cl factory (may be NULL)
+ *      and closure, and the suite's own closure for task
+ * Return: nothing, once every task has run
+ * Notes:
+ *      Makes each worker's closure with worker_cl(w, client_cl) on the
+ *      calling thread first, or uses client_cl when worker_cl is NULL,
+ *      as A2Methods_parallelmapfun promises. Tasks are handed out in
+ *      contiguous runs and rebalanced by work stealing (see
+ *      threadpool.h), so neighbouring tasks tend to share a worker.
+ *      The pool is started on the first run with nthreads threads and
+ *      kept for the next; runs at the same time get pools of their own
+ *
+ ************************/
+void A2Parallel_run(int nthreads, int ntasks, A2Parallel_taskfun *task,
+                    A2Methods_workerclfun *worker_cl, void *client_cl,
+                    void *cl);
+
+
+/**********A2Parallel_shutdown********
+ *
+ * Stops and frees the pools that A2Parallel_run keeps
+ * Inputs: nothing
+ * Return: nothing
+ * Expects: no run to be in progress (checked runtime error)
+ * Notes:
+ *      Happens by itself at exit, so it is only needed to get the
+ *      threads back sooner. A later run starts a new pool
+ *
+ ************************/
+void A2Parallel_shutdown(void);
+
+
+/**********A2Parallel_small_map********
+ *
+ * Implements small_map_parallel for a suite, given its map_parallel
+ * Inputs: the suite's map_parallel, then the small_map_parallel
+ *      arguments
+ * Return: nothing
+ * Notes:
+ *      Each worker gets its own small closure wrapping its own client
+ *      closure, so the small maps keep the per-worker promise too
+ *
+ ************************/
+void A2Parallel_small_map(A2Methods_parallelmapfun *map_parallel,
+                          A2Methods_UArray2 a2, int nthreads,
+                          A2Methods_smallapplyfun apply,
+                          A2Methods_workerclfun *worker_cl, void *cl);
+
+#endif
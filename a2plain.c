@@ -1,7 +1,8 @@
 #include <string.h>
 
-#include <a2plain.h>
+#include "a2plain.h"
 #include "uarray2.h"
+#include "a2parallel.h"
 
 /************************************************/
 /* Define a private version of each function in */
@@ -53,6 +54,11 @@ static A2Methods_Object *at(A2 array2, int i, int j)
         return UArray2_at(array2, i, j);
 }
 
+static A2Methods_Object *row_span(A2 array2, int j, int *length)
+{
+        return UArray2_row(array2, j, length);
+}
+
 static void map_row_major(A2Methods_UArray2 uarray2,
                           A2Methods_applyfun apply,
                           void *cl)
@@ -98,6 +104,54 @@ static void small_map_col_major(A2Methods_UArray2        a2,
         UArray2_map_col_major(a2, apply_small, &mycl);
 }
 
+static void map_region(A2Methods_view view, A2Methods_applyfun apply,
+                       void *cl)
+{
+        UArray2_map_region(view.parent, view.x, view.y, view.width,
+                           view.height, (UArray2_applyfun*)apply, cl);
+}
+
+static void small_map_region(A2Methods_view view,
+                             A2Methods_smallapplyfun apply, void *cl)
+{
+        struct small_closure mycl = { apply, cl };
+        UArray2_map_region(view.parent, view.x, view.y, view.width,
+                           view.height, apply_small, &mycl);
+}
+
+/* map_parallel hands out whole rows, one task per row */
+struct parallel_closure {
+        A2 array2;
+        A2Methods_applyfun *apply;
+};
+
+static void map_row(int j, void *workercl, void *vcl)
+{
+        struct parallel_closure *cl = vcl;
+        int width = UArray2_width(cl->array2);
+        for (int i = 0; i < width; i++) {
+                cl->apply(i, j, cl->array2, UArray2_at(cl->array2, i, j),
+                          workercl);
+        }
+}
+
+static void map_parallel(A2Methods_UArray2 uarray2, int nthreads,
+                         A2Methods_applyfun apply,
+                         A2Methods_workerclfun *worker_cl, void *cl)
+{
+        struct parallel_closure mycl = { uarray2, apply };
+        A2Parallel_run(nthreads, UArray2_height(uarray2), map_row,
+                       worker_cl, cl, &mycl);
+}
+
+static void small_map_parallel(A2Methods_UArray2 a2, int nthreads,
+                               A2Methods_smallapplyfun apply,
+                               A2Methods_workerclfun *worker_cl, void *cl)
+{
+        A2Parallel_small_map(map_parallel, a2, nthreads, apply, worker_cl,
+                             cl);
+}
+
 
 static struct A2Methods_T uarray2_methods_plain_struct = {
         new,
@@ -116,6 +170,12 @@ static struct A2Methods_T uarray2_methods_plain_struct = {
         small_map_col_major,                   
         NULL,                    //small_map_block_major,
         small_map_row_major,     // small_map_default
+        map_parallel,
+        small_map_parallel,
+        row_span,
+        NULL,                    // block_span
+        map_region,
+        small_map_region,
 };
 
 // finally the payoff: here is the exported pointer to the struct
@@ -0,0 +1,9 @@
+#ifndef A2PLAIN_INCLUDED
+#define A2PLAIN_INCLUDED
+
+#include "a2methods.h"
+
+/* Methods suite backed by UArray2, with row- and column-major mappings */
+extern A2Methods_T uarray2_methods_plain;
+
+#endif
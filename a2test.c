@@ -1,9 +1,18 @@
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 #include "assert.h"
 #include "a2methods.h"
 #include "a2plain.h"
+#include "a2flat.h"
+#include "a2morton.h"
 #include "a2blocked.h"
+#include "except.h"
+#include "a2parallel.h"
+#include "cacheinfo.h"
+#include "dihedral.h"
+#include "region.h"
 
 
 #define W 13
@@ -66,6 +75,36 @@ static void double_row_major_plus()
         methods->free(&array);
 }
 
+/* column-major maps must keep exact column-major order on arrays several
+   cache lines wide */
+#define CW (4 * 64 / (int)sizeof(int) + 3)
+
+static void double_col_major_plus()
+{
+        if (methods->map_col_major == NULL) {
+                return;
+        }
+        A2 array = methods->new_with_blocksize(CW, H, sizeof(int), BS);
+        int counter = 1;
+        for (int i = 0; i < CW; i++) {
+                for (int j = 0; j < H; j++) { /* row index varies faster */
+                        int *p = methods->at(array, i, j);
+                        *p = counter++;
+                }
+        }
+        counter = 1;
+        methods->map_col_major(array, check_and_increment, &counter);
+        assert(counter == CW * H + 1);
+        if (methods->small_map_col_major) {
+                counter = 1;
+                methods->small_map_col_major(array,
+                                             small_check_and_increment,
+                                             &counter);
+                assert(counter == CW * H + 1);
+        }
+        methods->free(&array);
+}
+
 #if 0
 static void show(int i, int j, A2 a, void *elem, void *cl) 
 {
@@ -113,6 +152,154 @@ bool has_blocked_methods(A2Methods_T m)
         return m->map_default != NULL && m->map_block_major != NULL;
 }
 
+/* the default map must visit every element exactly once, at its own cell */
+static void count_visit(int i, int j, A2 a, void *elem, void *cl)
+{
+        int *visits = cl;
+        assert(elem == methods->at(a, i, j));
+        visits[j * W + i] += 1;
+}
+
+static void check_default_map(A2 array)
+{
+        int visits[W * H] = { 0 };
+        methods->map_default(array, count_visit, visits);
+        for (int k = 0; k < W * H; k++) {
+                assert(visits[k] == 1);
+        }
+}
+
+/* a region map must visit each element of the view once, and no others */
+static A2Methods_view region;
+
+static void count_region_visit(int i, int j, A2 a, void *elem, void *cl)
+{
+        int *visits = cl;
+        assert(a == region.parent);
+        assert(i >= 0 && i < region.width && j >= 0 && j < region.height);
+        assert(elem == methods->at(a, region.x + i, region.y + j));
+        visits[j * W + i] += 1;
+}
+
+static void check_region_map(A2 array)
+{
+        if (methods->map_region == NULL) {
+                assert(methods->small_map_region == NULL);
+                return;
+        }
+        int views[][4] = { { 0, 0, W, H }, { 3, 2, 5, 7 }, 
+                           { BS - 1, BS + 1, W - BS, 1 }, 
+                           { W - 1, H - 1, 1, 1 }, { 2, 2, 0, 3 } };
+        for (unsigned v = 0; v < sizeof(views) / sizeof(views[0]); v++) {
+                region = (A2Methods_view){ array, views[v][0], views[v][1],
+                                           views[v][2], views[v][3] };
+                int visits[W * H] = { 0 };
+                methods->map_region(region, count_region_visit, visits);
+                for (int j = 0; j < H; j++) {
+                        for (int i = 0; i < W; i++) {
+                                bool inside = i < region.width && 
+                                              j < region.height;
+                                assert(visits[j * W + i] == (inside ? 1 : 0));
+                        }
+                }
+        }
+}
+
+/*
+ * The parallel maps must also visit every element exactly once, at its
+ * own cell, with each worker using the closure made for it. Visits
+ * bump the element atomically, so a cell visited by two threads at
+ * once still counts twice
+ */
+#define NTHREADS 4
+
+static void *worker_counter(int worker, void *cl)
+{
+        int *counters = cl;
+        return &counters[worker];
+}
+
+static void parallel_visit(int i, int j, A2 a, void *elem, void *cl)
+{
+        int *visited = cl;
+        assert(elem == methods->at(a, i, j));
+        __atomic_add_fetch((int *)elem, 1, __ATOMIC_RELAXED);
+        *visited += 1;
+}
+
+static void small_parallel_visit(void *elem, void *cl)
+{
+        (void)cl;
+        __atomic_add_fetch((int *)elem, 1, __ATOMIC_RELAXED);
+}
+
+static void check_parallel_map()
+{
+        if (methods->map_parallel == NULL) {
+                assert(methods->small_map_parallel == NULL);
+                return;
+        }
+        A2 array = methods->new_with_blocksize(W, H, sizeof(int), BS);
+        int counters[NTHREADS] = { 0 };
+        methods->map_parallel(array, NTHREADS, parallel_visit,
+                              worker_counter, counters);
+        int total = 0;
+        for (int w = 0; w < NTHREADS; w++) {
+                total += counters[w];
+        }
+        assert(total == W * H);
+
+        methods->small_map_parallel(array, NTHREADS, small_parallel_visit,
+                                    NULL, NULL);
+        for (int i = 0; i < W; i++) {
+                for (int j = 0; j < H; j++) {
+                        int *p = methods->at(array, i, j);
+                        assert(*p == 2);
+                }
+        }
+        methods->free(&array);
+}
+
+/* every span must cover exactly the elements at() says are there */
+static void check_spans(A2 array)
+{
+        int size = methods->size(array);
+        if (methods->row_span != NULL) {
+                for (int j = 0; j < H; j++) {
+                        int n;
+                        char *row = methods->row_span(array, j, &n);
+                        assert(n == W);
+                        for (int i = 0; i < W; i++) {
+                                assert(row + i * size == 
+                                       (char *)methods->at(array, i, j));
+                        }
+                }
+        }
+        if (methods->block_span != NULL) {
+                int bs = methods->blocksize(array);
+                int cells = 0;
+                for (int by = 0; by * bs < H; by++) {
+                        for (int bx = 0; bx * bs < W; bx++) {
+                                int stride, w, h;
+                                char *base = methods->block_span(array, bx, by,
+                                                                 &stride, &w,
+                                                                 &h);
+                                for (int r = 0; r < h; r++) {
+                                        for (int c = 0; c < w; c++) {
+                                                char *elem = methods->at(
+                                                        array, bx * bs + c,
+                                                        by * bs + r);
+                                                assert(elem == base + 
+                                                       r * stride + c * size);
+                                        }
+                                }
+                                cells += w * h;
+                        }
+                }
+                assert(cells == W * H);
+        }
+}
+
 static inline void copy_unsigned(A2Methods_T methods, A2 a,
                                  int i, int j, unsigned n) 
 {
@@ -157,16 +344,146 @@ static void test_methods(A2Methods_T methods_under_test)
                         assert(*p == n);
                 }
         }
+        check_default_map(array);
+        check_spans(array);
+        check_region_map(array);
+        check_parallel_map();
         double_row_major_plus();
+        double_col_major_plus();
         methods->free(&array);
 }
 
+/* power of two blocksizes index with shifts; make sure others still work */
+static void test_odd_blocksize()
+{
+        methods = uarray2_methods_blocked;
+        A2 array = methods->new_with_blocksize(W, H, sizeof(unsigned), 5);
+        for (int i = 0; i < W; i++) {
+                for (int j = 0; j < H; j++) {
+                        copy_unsigned(methods, array, i, j, 1000 * i + j);
+                }
+        }
+        for (int i = 0; i < W; i++) {
+                for (int j = 0; j < H; j++) {
+                        check(array, i, j, 1000 * i + j);
+                }
+        }
+        methods->free(&array);
+}
+
+/* whether the blocked suite turns down a blocksize */
+static bool rejects_blocksize(int blocksize)
+{
+        volatile bool raised = false;
+        TRY
+                A2 array = uarray2_methods_blocked->new_with_blocksize(W, H,
+                                                        1, blocksize);
+                uarray2_methods_blocked->free(&array);
+        EXCEPT(A2Blocked_Bad_blocksize)
+                raised = true;
+        END_TRY;
+        return raised;
+}
+
+/* blocked arrays can be asked for blocks sized to a cache level */
+static void test_cache_blocksize()
+{
+        methods = uarray2_methods_blocked;
+        int levels[] = { A2_BLOCKSIZE_L1, A2_BLOCKSIZE_L2, A2_BLOCKSIZE_LLC };
+        for (int k = 0; k < 3; k++) {
+                A2 array = methods->new_with_blocksize(W, H, sizeof(unsigned),
+                                                       levels[k]);
+                int expected = CacheInfo_blocksize(k + 1, sizeof(unsigned));
+                assert(methods->blocksize(array) == expected);
+                copy_unsigned(methods, array, W - 1, H - 1, 42);
+                check(array, W - 1, H - 1, 42);
+                methods->free(&array);
+        }
+        assert(CacheInfo_size(1) <= CacheInfo_size(2));
+        assert(CacheInfo_size(2) <= CacheInfo_size(3));
+
+        /* and nothing else at or below 0 */
+        for (int k = 0; k < 3; k++) {
+                assert(!rejects_blocksize(levels[k]));
+        }
+        assert(rejects_blocksize(0));
+        assert(rejects_blocksize(A2_BLOCKSIZE_LLC - 1));
+        assert(!rejects_blocksize(1));
+}
+
+/* Dihedral_compose against the table worked out pixel by pixel: the row
+   is the transform done first, the column the one done after it */
+static void test_dihedral_compose()
+{
+        enum { I, R90, R180, R270, FH, FV, TP, TV };
+        Dihedral_T d[] = {
+                DIHEDRAL_IDENTITY, DIHEDRAL_ROTATE90, DIHEDRAL_ROTATE180,
+                DIHEDRAL_ROTATE270, DIHEDRAL_FLIP_HORIZONTAL,
+                DIHEDRAL_FLIP_VERTICAL, DIHEDRAL_TRANSPOSE,
+                DIHEDRAL_TRANSVERSE
+        };
+        static const int table[8][8] = {
+                /*            I     R90   R180  R270  FH    FV    TP    TV */
+                /* I    */ { I,    R90,  R180, R270, FH,   FV,   TP,   TV   },
+                /* R90  */ { R90,  R180, R270, I,    TP,   TV,   FV,   FH   },
+                /* R180 */ { R180, R270, I,    R90,  FV,   FH,   TV,   TP   },
+                /* R270 */ { R270, I,    R90,  R180, TV,   TP,   FH,   FV   },
+                /* FH   */ { FH,   TV,   FV,   TP,   I,    R180, R270, R90  },
+                /* FV   */ { FV,   TP,   FH,   TV,   R180, I,    R90,  R270 },
+                /* TP   */ { TP,   FH,   TV,   FV,   R90,  R270, I,    R180 },
+                /* TV   */ { TV,   FV,   TP,   FH,   R270, R90,  R180, I    },
+        };
+        for (int i = 0; i < 8; i++) {
+                for (int j = 0; j < 8; j++) {
+                        assert(Dihedral_compose(d[i], d[j]) == 
+                               d[table[i][j]]);
+                }
+        }
+}
+
+/* a region's memory comes back zeroed after a reset and aligned as
+   asked, and a request bigger than a chunk gets a mapping of its own */
+#define CHUNK (64 << 10)
+
+static void test_region()
+{
+        Region_T r = Region_new(CHUNK, REGION_PAGES);
+        for (size_t align = 1; align <= 4096; align *= 2) {
+                char *p = Region_alloc(r, 3, align);
+                assert((uintptr_t)p % align == 0);
+                memset(p, 0xff, 3);
+        }
+        char *p = Region_alloc(r, 1000, 8);
+        memset(p, 0xff, 1000);
+
+        Region_reset(r);
+        char *q = Region_alloc(r, 16384, 1);
+        for (int i = 0; i < 16384; i++) {
+                assert(q[i] == 0);
+        }
+
+        struct Region_stats before = Region_stats(r);
+        char *big = Region_alloc(r, 4 * CHUNK, 64);
+        struct Region_stats after = Region_stats(r);
+        assert(after.mappings == before.mappings + 1);
+        assert(after.mapped >= before.mapped + 4 * CHUNK);
+        assert(Region_owns(r, big) && Region_owns(r, big + 4 * CHUNK - 1));
+        Region_free(&r);
+}
+
 int main(int argc, char *argv[])
 {
         assert(argc == 1);
         (void)argv;
         test_methods(uarray2_methods_plain);
+        test_methods(uarray2_methods_flat);
         test_methods(uarray2_methods_blocked);
+        test_methods(uarray2_methods_morton);
+        A2Parallel_shutdown();  /* the suites' maps shared pools */
+        test_odd_blocksize();
+        test_cache_blocksize();
+        test_dihedral_compose();
+        test_region();
         printf("Passed.\n");  /* only if we reach this point without
                                * assertion failure
                                */
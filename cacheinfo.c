@@ -0,0 +1,141 @@
+/*
+ *     cacheinfo.c
+ *
+ *     locality
+ *
+ *     This is the implementation file for our CacheInfo interface.
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+
+#include "assert.h"
+#include "cacheinfo.h"
+
+#define SYSFS_CACHE "/sys/devices/system/cpu/cpu0/cache"
+#define MAX_INDEX 16
+
+/* what we assume when sysfs can't tell us */
+static int cachesizes[4] = { 0, 32 * 1024, 256 * 1024, 8 * 1024 * 1024 };
+static int linesize = 64;
+static int default_level = 2;
+
+/* the kernels ask from worker threads, so only one of them may fill in
+   the sizes */
+static pthread_once_t initialized = PTHREAD_ONCE_INIT;
+
+/* reads the first line of SYSFS_CACHE/index<index>/<name> into buf */
+static int read_attribute(int index, const char *name, char *buf, int len)
+{
+        char path[128];
+        snprintf(path, sizeof(path), SYSFS_CACHE "/index%d/%s", index, name);
+        FILE *fp = fopen(path, "r");
+        if (fp == NULL) {
+                return 0;
+        }
+        int ok = fgets(buf, len, fp) != NULL;
+        fclose(fp);
+        return ok;
+}
+
+/* sizes look like "48K" or "16M" */
+static int parse_size(const char *buf)
+{
+        char unit = '\0';
+        int n = 0;
+        if (sscanf(buf, "%d%c", &n, &unit) < 1 || n <= 0) {
+                return 0;
+        }
+        if (unit == 'K') {
+                n *= 1024;
+        } else if (unit == 'M') {
+                n *= 1024 * 1024;
+        }
+        return n;
+}
+
+static void initialize(void)
+{
+        char buf[64];
+        int found[4] = { 0, 0, 0, 0 };
+        int deepest = 0;
+
+        for (int i = 0; i < MAX_INDEX; i++) {
+                if (!read_attribute(i, "level", buf, sizeof(buf))) {
+                        break;
+                }
+                int level = 0;
+                sscanf(buf, "%d", &level);
+                if (!read_attribute(i, "type", buf, sizeof(buf)) ||
+                    strncmp(buf, "Instruction", 11) == 0) {
+                        continue;
+                }
+                if (level < 1 || level > 4 ||
+                    !read_attribute(i, "size", buf, sizeof(buf))) {
+                        continue;
+                }
+                int size = parse_size(buf);
+                if (size <= 0) {
+                        continue;
+                }
+                if (level == 1 && 
+                    read_attribute(i, "coherency_line_size", buf, 
+                                   sizeof(buf))) {
+                        int n = 0;
+                        if (sscanf(buf, "%d", &n) == 1 && n > 0) {
+                                linesize = n;
+                        }
+                }
+                /* an L4 still counts as the last level */
+                int slot = level > 3 ? 3 : level;
+                cachesizes[slot] = size;
+                found[slot] = 1;
+                if (level > deepest) {
+                        deepest = level;
+                }
+        }
+
+        /* a machine with no L3 has its L2 as the last level cache */
+        if (deepest == 2 && found[2] && !found[3]) {
+                cachesizes[3] = cachesizes[2];
+        }
+}
+
+int CacheInfo_size(int level)
+{
+        assert(level >= 1 && level <= 3);
+        pthread_once(&initialized, initialize);
+        return cachesizes[level];
+}
+
+int CacheInfo_linesize(void)
+{
+        pthread_once(&initialized, initialize);
+        return linesize;
+}
+
+int CacheInfo_blocksize(int level, int size)
+{
+        assert(size > 0);
+        double elems = (CacheInfo_size(level) / 2.0) / size;
+        int fits = sqrt(elems);
+        int blocksize = 1;
+        while (blocksize * 2 <= fits) {
+                blocksize *= 2;
+        }
+        return blocksize;
+}
+
+void CacheInfo_set_default_level(int level)
+{
+        assert(level >= 1 && level <= 3);
+        default_level = level;
+}
+
+int CacheInfo_default_level(void)
+{
+        return default_level;
+}
@@ -0,0 +1,80 @@
+/*
+ *     cacheinfo.h
+ *
+ *     locality
+ *
+ *     This is the header file for the CacheInfo interface, which reports
+ *     the data cache sizes of the machine we are running on and turns
+ *     them into block sizes for UArray2b.
+ *
+ */
+
+#ifndef CACHEINFO_INCLUDED
+#define CACHEINFO_INCLUDED
+
+/*
+ * Passing one of these as the blocksize to new_with_blocksize in
+ * uarray2_methods_blocked asks for blocks sized for that cache level
+ * instead of a fixed blocksize. LLC is the last level cache, whatever
+ * level that happens to be on this machine.
+ */
+#define A2_BLOCKSIZE_L1  (-1)
+#define A2_BLOCKSIZE_L2  (-2)
+#define A2_BLOCKSIZE_LLC (-3)
+
+
+/**********CacheInfo_size********
+ *
+ * Returns the size in bytes of the data (or unified) cache at a level
+ * Inputs: cache level, 1 for L1, 2 for L2, 3 for the last level cache
+ * Return: the cache size in bytes
+ * Expects: level to be 1, 2 or 3
+ *
+ * Notes:
+ *      Sizes are read once from /sys/devices/system/cpu/cpu0/cache. If
+ *      that isn't available we fall back to 32K / 256K / 8M
+ *
+ ************************/
+int CacheInfo_size(int level);
+
+
+/**********CacheInfo_linesize********
+ *
+ * Returns the size in bytes of an L1 data cache line
+ * Inputs: none
+ * Return: cache line size, 64 if it can't be found
+ *
+ ************************/
+int CacheInfo_linesize(void);
+
+
+/**********CacheInfo_blocksize********
+ *
+ * Picks a UArray2b blocksize for a cache level and element size
+ * Inputs: cache level (1, 2 or 3), size of one element in bytes
+ * Return: the largest power of two blocksize whose block fills no more
+ *      than half of the cache, and at least 1
+ * Expects: size to be greater than 0
+ *
+ * Notes:
+ *      Half, because a transform streams one source block while it
+ *      writes the matching destination block, and both should stay
+ *      resident. Powers of two let UArray2b index with shifts and masks
+ *
+ ************************/
+int CacheInfo_blocksize(int level, int size);
+
+
+/**********CacheInfo_set_default_level / CacheInfo_default_level********
+ *
+ * Sets / returns the cache level that UArray2b_new_64K_block (and so the
+ * new method of uarray2_methods_blocked) sizes its blocks for
+ * Inputs: cache level, 1, 2 or 3
+ *
+ * Notes: the default is 2
+ *
+ ************************/
+void CacheInfo_set_default_level(int level);
+int CacheInfo_default_level(void);
+
+#endif
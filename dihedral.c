@@ -0,0 +1,56 @@
+/*
+ *     dihedral.c
+ *
+ *     locality
+ *
+ *     This is the implementation file for our Dihedral interface.
+ *
+ */
+
+#include "assert.h"
+#include "dihedral.h"
+
+/* a transform as transpose, then flip horizontally, then vertically */
+enum { TRANSPOSE = 4, HORIZONTAL = 2, VERTICAL = 1 };
+
+static const Dihedral_T elements[8] = {
+        DIHEDRAL_IDENTITY,              /* nothing */
+        DIHEDRAL_FLIP_VERTICAL,         /* vertical */
+        DIHEDRAL_FLIP_HORIZONTAL,       /* horizontal */
+        DIHEDRAL_ROTATE180,             /* horizontal, vertical */
+        DIHEDRAL_TRANSPOSE,             /* transpose */
+        DIHEDRAL_ROTATE270,             /* transpose, vertical */
+        DIHEDRAL_ROTATE90,              /* transpose, horizontal */
+        DIHEDRAL_TRANSVERSE             /* transpose, both */
+};
+
+static int bits(Dihedral_T t)
+{
+        for (int b = 0; b < 8; b++) {
+                if (elements[b] == t) {
+                        return b;
+                }
+        }
+        assert(0);
+        return 0;
+}
+
+Dihedral_T Dihedral_compose(Dihedral_T first, Dihedral_T then)
+{
+        int a = bits(first);
+        int b = bits(then);
+        if (b & TRANSPOSE) {
+                /* what was horizontal is now vertical, and back */
+                a = (a & TRANSPOSE) | (a & HORIZONTAL) >> 1 |
+                    (a & VERTICAL) << 1;
+        }
+        return elements[a ^ b];
+}
+
+bool Dihedral_swapsaxes(int transform)
+{
+        return transform == DIHEDRAL_ROTATE90 ||
+               transform == DIHEDRAL_ROTATE270 ||
+               transform == DIHEDRAL_TRANSPOSE ||
+               transform == DIHEDRAL_TRANSVERSE;
+}
@@ -0,0 +1,57 @@
+/*
+ *     dihedral.h
+ *
+ *     locality
+ *
+ *     This is the header file for the Dihedral interface: the eight ways
+ *     ppmtrans can rotate, flip or transpose an image, and how a sequence
+ *     of them composes into one.
+ *
+ */
+
+#ifndef DIHEDRAL_INCLUDED
+#define DIHEDRAL_INCLUDED
+
+#include <stdbool.h>
+
+/*
+ * The values are the rotations as ppmtrans has always encoded them, which
+ * every engine takes as an int. Transverse is the transpose across the
+ * other diagonal: the top right pixel stays put
+ */
+typedef enum Dihedral_T {
+        DIHEDRAL_IDENTITY        = 0,
+        DIHEDRAL_ROTATE90        = 90,
+        DIHEDRAL_ROTATE180       = 180,
+        DIHEDRAL_ROTATE270       = 270,
+        DIHEDRAL_FLIP_HORIZONTAL = 360,
+        DIHEDRAL_FLIP_VERTICAL   = 450,
+        DIHEDRAL_TRANSPOSE       = 540,
+        DIHEDRAL_TRANSVERSE      = 630
+} Dihedral_T;
+
+
+/**********Dihedral_compose********
+ *
+ * The single transform that does first and then then
+ * Inputs: two transforms, in the order they are applied
+ * Return: their composition
+ * Notes:
+ *      Every transform is a transpose or not, followed by a horizontal
+ *      flip or not and a vertical flip or not. A later transpose turns
+ *      the earlier flips into each other, and the rest just add up
+ *
+ ************************/
+Dihedral_T Dihedral_compose(Dihedral_T first, Dihedral_T then);
+
+
+/**********Dihedral_swapsaxes********
+ *
+ * Says whether a transform turns a w x h image into an h x w one
+ * Inputs: the transform, as a Dihedral_T or ppmtrans's int encoding
+ * Return: true for 90, 270, transpose and transverse
+ *
+ ************************/
+bool Dihedral_swapsaxes(int transform);
+
+#endif
@@ -0,0 +1,248 @@
+/*
+ *     inplace.c
+ *
+ *     locality
+ *
+ *     This is the implementation file for our Inplace interface.
+ *
+ */
+
+#include <stddef.h>
+#include <string.h>
+
+#include "assert.h"
+#include "mem.h"
+#include "inplace.h"
+#include "a2flat.h"
+#include "uarray2f_impl.h"
+#include "dihedral.h"
+
+typedef A2Methods_UArray2 A2;
+
+/* pairs or fours of TILE x TILE tiles are worked on together */
+#define TILE 16
+
+struct grid {
+        A2Methods_T methods;
+        A2 array;
+        UArray2f_T flat;        /* the array if it is a UArray2f, or NULL */
+        int size;
+        int width;
+        int height;
+};
+
+static inline char *elem(struct grid *g, int i, int j)
+{
+        if (g->flat != NULL) {
+                return UArray2f_rowstart(g->flat, j) + (size_t)i * g->size;
+        }
+        return g->methods->at(g->array, i, j);
+}
+
+static inline void swap(char *a, char *b, int size)
+{
+        for (int k = 0; k < size; k++) {
+                char tmp = a[k];
+                a[k] = b[k];
+                b[k] = tmp;
+        }
+}
+
+static inline int min(int a, int b)
+{
+        return a < b ? a : b;
+}
+
+static void flip_horizontal(struct grid *g)
+{
+        int w = g->width;
+        for (int j = 0; j < g->height; j++) {
+                for (int i = 0; i < w / 2; i++) {
+                        swap(elem(g, i, j), elem(g, w - 1 - i, j), g->size);
+                }
+        }
+}
+
+static void flip_vertical(struct grid *g)
+{
+        int h = g->height;
+        for (int j = 0; j < h / 2; j++) {
+                for (int i = 0; i < g->width; i++) {
+                        swap(elem(g, i, j), elem(g, i, h - 1 - j), g->size);
+                }
+        }
+}
+
+/* each row swapped with its mirror, reversed; an odd middle row just
+   reversed */
+static void rotate180(struct grid *g)
+{
+        int w = g->width;
+        int h = g->height;
+        for (int j = 0; j < (h + 1) / 2; j++) {
+                int last = j == h - 1 - j ? w / 2 : w;
+                for (int i = 0; i < last; i++) {
+                        swap(elem(g, i, j), elem(g, w - 1 - i, h - 1 - j),
+                             g->size);
+                }
+        }
+}
+
+/* tiles on and below the diagonal, each swapped with its mirror tile */
+static void transpose_square(struct grid *g)
+{
+        int n = g->width;
+        for (int tj = 0; tj < n; tj += TILE) {
+                for (int ti = 0; ti <= tj; ti += TILE) {
+                        for (int j = tj; j < min(tj + TILE, n); j++) {
+                                for (int i = ti;
+                                     i < min(ti + TILE, j); i++) {
+                                        swap(elem(g, i, j), elem(g, j, i),
+                                             g->size);
+                                }
+                        }
+                }
+        }
+}
+
+/*
+ * Every element of the top left quarter (the extra middle row included
+ * when n is odd) starts one cycle of four: it, where it goes, where that
+ * goes, and where that goes. Three swaps with the first move all four
+ * one step along. Working through the quarter in tiles keeps the four
+ * tiles each tile touches in L1
+ */
+static void rotate_square(struct grid *g, bool clockwise)
+{
+        int n = g->width;
+        int m = n - 1;
+        int size = g->size;
+        for (int tj = 0; tj < (n + 1) / 2; tj += TILE) {
+                for (int ti = 0; ti < n / 2; ti += TILE) {
+                        for (int j = tj; j < min(tj + TILE, (n + 1) / 2);
+                             j++) {
+                                for (int i = ti; i < min(ti + TILE, n / 2);
+                                     i++) {
+                                        char *p0 = elem(g, i, j);
+                                        char *p1 = clockwise
+                                                ? elem(g, m - j, i)
+                                                : elem(g, j, m - i);
+                                        char *p2 = elem(g, m - i, m - j);
+                                        char *p3 = clockwise
+                                                ? elem(g, j, m - i)
+                                                : elem(g, m - j, i);
+                                        swap(p0, p1, size);
+                                        swap(p0, p2, size);
+                                        swap(p0, p3, size);
+                                }
+                        }
+                }
+        }
+}
+
+/*
+ * Transposes a UArray2f that isn't square. Its slab is dense (the stride
+ * is width * size), so element k = j * w + i of the h rows of w belongs
+ * at k' = i * h + j of the w rows of h. Each cycle of that permutation is
+ * walked backwards from its first element, pulling each element into
+ * place from the one that belongs there, and marked off in the bitmap
+ */
+static void transpose_flat(struct grid *g)
+{
+        UArray2f_T a = g->flat;
+        int size = g->size;
+        size_t w = g->width;
+        size_t h = g->height;
+        size_t n = w * h;
+        assert((size_t)a->stride == w * size);
+
+        unsigned char *moved = CALLOC((n + 7) / 8, 1);
+        char *saved = ALLOC(size);
+        for (size_t start = 0; start < n; start++) {
+                if (moved[start / 8] & (1 << start % 8)) {
+                        continue;
+                }
+                memcpy(saved, a->elems + start * size, size);
+                size_t at = start;
+                for (;;) {
+                        moved[at / 8] |= 1 << at % 8;
+                        size_t from = (at % h) * w + at / h;
+                        if (from == start) {
+                                break;
+                        }
+                        memcpy(a->elems + at * size, a->elems + from * size,
+                               size);
+                        at = from;
+                }
+                memcpy(a->elems + at * size, saved, size);
+        }
+        FREE(saved);
+        FREE(moved);
+
+        a->width = h;
+        a->height = w;
+        a->stride = h * size;
+        g->width = h;
+        g->height = w;
+}
+
+bool Inplace_handles(A2Methods_T methods, A2 array, int rotation)
+{
+        assert(methods != NULL && array != NULL);
+        return !Dihedral_swapsaxes(rotation) ||
+               methods->width(array) == methods->height(array)
+               || methods == uarray2_methods_flat;
+}
+
+void Inplace_transform(A2Methods_T methods, A2 array, int rotation)
+{
+        assert(Inplace_handles(methods, array, rotation));
+        struct grid g;
+        g.methods = methods;
+        g.array = array;
+        g.flat = methods == uarray2_methods_flat ? array : NULL;
+        g.size = methods->size(array);
+        g.width = methods->width(array);
+        g.height = methods->height(array);
+        bool square = g.width == g.height;
+
+        switch (rotation) {
+        case 0:
+                break;
+        case 180:
+                rotate180(&g);
+                break;
+        case 360:
+                flip_horizontal(&g);
+                break;
+        case 450:
+                flip_vertical(&g);
+                break;
+        case 540:
+        case 630:
+                if (square) {
+                        transpose_square(&g);
+                } else {
+                        transpose_flat(&g);
+                }
+                if (rotation == 630) {
+                        rotate180(&g);
+                }
+                break;
+        case 90:
+        case 270:
+                if (square) {
+                        rotate_square(&g, rotation == 90);
+                } else {
+                        transpose_flat(&g);
+                        if (rotation == 90) {
+                                flip_horizontal(&g);
+                        } else {
+                                flip_vertical(&g);
+                        }
+                }
+                break;
+        default:
+                assert(0);
+        }
+}
@@ -0,0 +1,58 @@
+/*
+ *     inplace.h
+ *
+ *     locality
+ *
+ *     This is the header file for the Inplace interface, which does the
+ *     ppmtrans rotations, flips and transpose inside the source array
+ *     instead of copying it into a second one.
+ *
+ */
+
+#ifndef INPLACE_INCLUDED
+#define INPLACE_INCLUDED
+
+#include <stdbool.h>
+#include "a2methods.h"
+
+
+/**********Inplace_handles********
+ *
+ * Says whether Inplace_transform can do a rotation to an array
+ * Inputs: the array's methods suite, the array, and the rotation as
+ *      ppmtrans encodes it
+ * Return: true unless the rotation swaps the axes (90, 270, transpose,
+ *      transverse), the array isn't square, and it isn't a UArray2f
+ *
+ ************************/
+bool Inplace_handles(A2Methods_T methods, A2Methods_UArray2 array,
+                     int rotation);
+
+
+/**********Inplace_transform********
+ *
+ * Rotates, flips or transposes array in place
+ * Inputs: the array's methods suite, the array, and the rotation as
+ *      ppmtrans encodes it (a Dihedral_T, see dihedral.h)
+ * Return: nothing
+ * Expects: Inplace_handles(methods, array, rotation)
+ * Notes:
+ *      180 and the flips swap pairs of elements, and work with any
+ *      suite. On a square array, transpose swaps pairs across the
+ *      diagonal and 90 and 270 move each element one step around a
+ *      cycle of four, all in tiles of 16 x 16 so each pair (or four) of
+ *      tiles stays in L1. A UArray2f that isn't square is transposed by
+ *      following the cycles of the transpose permutation through its
+ *      dense slab, with one bit per element to mark the ones already
+ *      moved, and then given its new width, height and stride. 90 and
+ *      270 are that transpose followed by a horizontal or vertical flip.
+ *      Transverse is transpose followed by 180.
+ *      Cycle following visits the slab in no useful order, so it is
+ *      slower than copying, but it only needs the bitmap besides the
+ *      array itself
+ *
+ ************************/
+void Inplace_transform(A2Methods_T methods, A2Methods_UArray2 array,
+                       int rotation);
+
+#endif
@@ -0,0 +1,495 @@
+/*
+ *     kernels.c
+ *
+ *     locality
+ *
+ *     This is the implementation file for our Kernels interface.
+ *
+ *     Every transform is broken into runs: a source run is a stretch of
+ *     pixels that are contiguous in one source row, and it lands in the
+ *     destination as a run going right, left, down or up. Horizontal runs
+ *     are copies (reversed for the flips and 180); vertical runs step by
+ *     the destination's row stride. Blocked destinations split a run
+ *     wherever it crosses into the next block.
+ *
+ *     The vertical transforms (90, 270, transpose, transverse) take four
+ *     source rows at a time and move 4 x 4 tiles with the SIMD transpose
+ *     for the element size, falling back to runs for the ragged edges and
+ *     for tiles whose destination rows straddle two blocks.
+ *
+ */
+
+#include <string.h>
+#include <stddef.h>
+
+#include "assert.h"
+#include "kernels.h"
+#include "a2flat.h"
+#include "a2blocked.h"
+#include "uarray2f_impl.h"
+#include "uarray2b_impl.h"
+#include "cacheinfo.h"
+#include "simd.h"
+
+/* which way a source run travels through the destination */
+enum direction { RIGHT, LEFT, DOWN, UP };
+
+/* where source pixel (col, row) lands, and which way its row runs */
+static inline enum direction destination(int rotation, int w, int h,
+                                         int col, int row,
+                                         int *dcol, int *drow)
+{
+        switch (rotation) {
+        case 0:
+                *dcol = col;         *drow = row;         return RIGHT;
+        case 90:
+                *dcol = h - row - 1; *drow = col;         return DOWN;
+        case 180:
+                *dcol = w - col - 1; *drow = h - row - 1; return LEFT;
+        case 270:
+                *dcol = row;         *drow = w - col - 1; return UP;
+        case 360:
+                *dcol = w - col - 1; *drow = row;         return LEFT;
+        case 450:
+                *dcol = col;         *drow = h - row - 1; return RIGHT;
+        case 540:
+                *dcol = row;         *drow = col;         return DOWN;
+        case 630:
+                *dcol = h - row - 1; *drow = w - col - 1; return UP;
+        }
+        assert(0);
+        *dcol = col;
+        *drow = row;
+        return RIGHT;
+}
+
+/*
+ * The part of the source being transformed, as if it were the whole
+ * image: the whole source, or a view of it. Source pixel (col, row) is
+ * pixel (col - x, row - y) of the frame
+ */
+struct frame {
+        int x, y;
+        int width, height;
+};
+
+/* destination, for source pixels given in the source's coordinates */
+static inline enum direction place(int rotation, const struct frame *f,
+                                   int col, int row, int *dcol, int *drow)
+{
+        return destination(rotation, f->width, f->height, col - f->x,
+                           row - f->y, dcol, drow);
+}
+
+#define STRIDED(SIZE)                                                   \
+        for (int k = 0; k < n; k++, d += step, s += (SIZE)) {           \
+                memcpy(d, s, (SIZE));                                   \
+        }
+
+/*
+ * Copies n contiguous elements from s to d, where step is the distance in
+ * bytes from one destination element to the next (-size for a reversed
+ * copy). Every pixel format gets its own loop, so each element is a
+ * constant size copy, a move or two
+ */
+static inline void copy_strided(char *d, const char *s, int n,
+                                ptrdiff_t step, int size)
+{
+        switch (size) {
+        case 1:  STRIDED(1);  break;
+        case 2:  STRIDED(2);  break;
+        case 3:  STRIDED(3);  break;
+        case 4:  STRIDED(4);  break;
+        case 6:  STRIDED(6);  break;
+        case 8:  STRIDED(8);  break;
+        case 12: STRIDED(12); break;
+        default: STRIDED(size);
+        }
+}
+
+/*
+ * The vertical transforms go down the source in strips this many
+ * columns wide, so the destination rows a strip writes stay in L1. Half
+ * an L1-sized block leaves room for block strides that are multiples of
+ * 1K, which crowd into a few cache sets
+ */
+static int strip_width(int size)
+{
+        int strip = CacheInfo_blocksize(1, size) / 2;
+        return strip < 4 ? 4 : strip;
+}
+
+/*
+ * Flat to flat. Runs never need splitting; the vertical transforms walk
+ * the region in tiles so the destination lines they touch stay cached
+ */
+static void flat_run(UArray2f_T dst, enum direction dir, int dcol, int drow,
+                     const char *s, int n)
+{
+        int size = dst->size;
+        char *d = UArray2f_rowstart(dst, drow) + (size_t)dcol * size;
+        switch (dir) {
+        case RIGHT: memcpy(d, s, (size_t)n * size);             break;
+        case LEFT:  copy_strided(d, s, n, -size, size);         break;
+        case DOWN:  copy_strided(d, s, n, dst->stride, size);   break;
+        case UP:    copy_strided(d, s, n, -dst->stride, size);  break;
+        }
+}
+
+/*
+ * Blocked to blocked. Walks the source a block at a time, so each source
+ * run is a row of one block, then cuts the destination run wherever it
+ * leaves a destination block
+ */
+static void blocked_run(UArray2b_T dst, enum direction dir, int dcol, 
+                        int drow, const char *s, int n)
+{
+        int size = dst->size;
+        while (n > 0) {
+                int bx = UArray2b_blockof(dst, dcol);
+                int by = UArray2b_blockof(dst, drow);
+                int cx = UArray2b_cellof(dst, dcol);
+                int cy = UArray2b_cellof(dst, drow);
+                int bw = UArray2b_blockwidth(dst, bx);
+                char *d = UArray2b_addr(dst, dcol, drow);
+                int room;
+
+                switch (dir) {
+                case RIGHT:
+                        room = bw - cx < n ? bw - cx : n;
+                        memcpy(d, s, (size_t)room * size);
+                        dcol += room;
+                        break;
+                case LEFT:
+                        room = cx + 1 < n ? cx + 1 : n;
+                        copy_strided(d, s, room, -size, size);
+                        dcol -= room;
+                        break;
+                case DOWN:
+                        room = UArray2b_blockheight(dst, by) - cy;
+                        room = room < n ? room : n;
+                        copy_strided(d, s, room, (ptrdiff_t)bw * size,
+                                     size);
+                        drow += room;
+                        break;
+                default:
+                        room = cy + 1 < n ? cy + 1 : n;
+                        copy_strided(d, s, room, -(ptrdiff_t)bw * size,
+                                     size);
+                        drow -= room;
+                        break;
+                }
+                s += (size_t)room * size;
+                n -= room;
+        }
+}
+
+/*
+ * Either kind of array, so the vertical transforms can share one loop.
+ * flat never changes inside a transform, so the branches are free
+ */
+static inline char *pixel_at(bool flat, void *array, int i, int j)
+{
+        if (flat) {
+                UArray2f_T a = array;
+                return UArray2f_rowstart(a, j) + (size_t)i * a->size;
+        }
+        return UArray2b_addr(array, i, j);
+}
+
+static inline void run(bool flat, void *dst, enum direction dir, 
+                       int dcol, int drow, const char *s, int n)
+{
+        if (flat) {
+                flat_run(dst, dir, dcol, drow, s, n);
+        } else {
+                blocked_run(dst, dir, dcol, drow, s, n);
+        }
+}
+
+/* do the 4 destination pixels starting at column dcol share a block? */
+static inline bool contiguous4(bool flat, void *dst, int dcol)
+{
+        if (flat) {
+                return true;
+        }
+        UArray2b_T b = dst;
+        return UArray2b_cellof(b, dcol) + 4 <= 
+               UArray2b_blockwidth(b, UArray2b_blockof(b, dcol));
+}
+
+/*
+ * Bytes from destination pixel (dcol, drow) to the one a row further in
+ * direction dir, if the next three rows that way are in the same block
+ * (always, for flat arrays); 0 if they aren't
+ */
+static inline ptrdiff_t row_step(bool flat, void *dst, enum direction dir,
+                                 int dcol, int drow)
+{
+        if (flat) {
+                ptrdiff_t stride = ((UArray2f_T)dst)->stride;
+                return dir == DOWN ? stride : -stride;
+        }
+        UArray2b_T b = dst;
+        int by = UArray2b_blockof(b, drow);
+        int cy = UArray2b_cellof(b, drow);
+        if (dir == DOWN ? cy + 4 > UArray2b_blockheight(b, by) : cy < 3) {
+                return 0;
+        }
+        ptrdiff_t stride = (ptrdiff_t)UArray2b_blockwidth(b,
+                                UArray2b_blockof(b, dcol)) * b->size;
+        return dir == DOWN ? stride : -stride;
+}
+
+/*
+ * 90, 270 or transpose of the w x h source rectangle at (x, y), whose
+ * rows must each be contiguous (anywhere in a flat array, or inside one
+ * block of a blocked one)
+ */
+static void vertical_rect(bool flat, void *src, void *dst, int rotation,
+                          const struct frame *f, enum direction dir, 
+                          int x, int y, int w, int h)
+{
+        int size = flat ? ((UArray2f_T)src)->size 
+                        : ((UArray2b_T)src)->size;
+        Simd_tilefun *transpose = Simd_transpose4_sized(size);
+        int w4 = w & ~3;
+        int dcol, drow;
+        int row = y;
+
+        /* 90 and transverse put later source rows further left, so their
+           tiles take their source rows bottom up */
+        bool reversed = rotation == 90 || rotation == 630;
+
+        for (; row + 4 <= y + h; row += 4) {
+                const char *s[4];
+                for (int q = 0; q < 4; q++) {
+                        s[q] = pixel_at(flat, src, x, 
+                                        reversed ? row + 3 - q : row + q);
+                }
+                for (int c = 0; c < w4; c += 4) {
+                        size_t at = (size_t)c * size;
+                        const void *tile[4] = { s[0] + at, s[1] + at, 
+                                                s[2] + at, s[3] + at };
+                        char *d[4];
+                        place(rotation, f, x + c, reversed ? row + 3 : row,
+                              &dcol, &drow);
+                        d[0] = pixel_at(flat, dst, dcol, drow);
+                        ptrdiff_t step = row_step(flat, dst, dir, dcol, 
+                                                  drow);
+                        for (int k = 1; k < 4; k++) {
+                                if (step != 0) {
+                                        d[k] = d[k - 1] + step;
+                                } else {
+                                        d[k] = pixel_at(flat, dst, dcol, 
+                                                dir == DOWN ? drow + k 
+                                                            : drow - k);
+                                }
+                        }
+                        if (contiguous4(flat, dst, dcol)) {
+                                void *const tiled[4] = { d[0], d[1], 
+                                                         d[2], d[3] };
+                                transpose(tiled, tile);
+                                continue;
+                        }
+                        for (int q = 0; q < 4; q++) {
+                                place(rotation, f, x + c, row + q, &dcol,
+                                      &drow);
+                                run(flat, dst, dir, dcol, drow, 
+                                    pixel_at(flat, src, x + c, row + q), 4);
+                        }
+                }
+                for (int q = 0; w4 < w && q < 4; q++) {
+                        place(rotation, f, x + w4, row + q, &dcol, &drow);
+                        run(flat, dst, dir, dcol, drow, 
+                            pixel_at(flat, src, x + w4, row + q), w - w4);
+                }
+        }
+        for (; row < y + h; row++) {
+                place(rotation, f, x, row, &dcol, &drow);
+                run(flat, dst, dir, dcol, drow, 
+                    pixel_at(flat, src, x, row), w);
+        }
+}
+
+static void flat_region(UArray2f_T src, UArray2f_T dst, int rotation,
+                        const struct frame *f, int x, int y, int w, int h)
+{
+        int dcol, drow;
+        enum direction dir = place(rotation, f, f->x, f->y, &dcol, &drow);
+        if (dir == DOWN || dir == UP) {
+                int strip = strip_width(src->size);
+                for (int tx = x; tx < x + w; tx += strip) {
+                        int n = strip < x + w - tx ? strip : x + w - tx;
+                        vertical_rect(true, src, dst, rotation, f, dir, 
+                                      tx, y, n, h);
+                }
+                return;
+        }
+
+        for (int row = y; row < y + h; row++) {
+                const char *s = pixel_at(true, src, x, row);
+                place(rotation, f, x, row, &dcol, &drow);
+                flat_run(dst, dir, dcol, drow, s, w);
+        }
+}
+
+static void blocked_region(UArray2b_T src, UArray2b_T dst, int rotation,
+                           const struct frame *f, int x, int y, int w, int h)
+{
+        int bs = src->blocksize;
+        int firstbx = UArray2b_blockof(src, x);
+        int lastbx = UArray2b_blockof(src, x + w - 1);
+        int firstby = UArray2b_blockof(src, y);
+        int lastby = UArray2b_blockof(src, y + h - 1);
+        int dcol, drow;
+        enum direction dir = place(rotation, f, f->x, f->y, &dcol, &drow);
+        bool vertical = dir == DOWN || dir == UP;
+        int strip = strip_width(src->size);
+
+        for (int by = firstby; by <= lastby; by++) {
+                int top = by * bs;
+                int row0 = top > y ? top : y;
+                int row1 = top + UArray2b_blockheight(src, by);
+                row1 = row1 < y + h ? row1 : y + h;
+                for (int bx = firstbx; bx <= lastbx; bx++) {
+                        int left = bx * bs;
+                        int col0 = left > x ? left : x;
+                        int col1 = left + UArray2b_blockwidth(src, bx);
+                        col1 = col1 < x + w ? col1 : x + w;
+                        if (vertical) {
+                                for (int tx = col0; tx < col1; tx += strip) {
+                                        int n = strip < col1 - tx 
+                                              ? strip : col1 - tx;
+                                        vertical_rect(false, src, dst, 
+                                                      rotation, f, dir, tx,
+                                                      row0, n, row1 - row0);
+                                }
+                                continue;
+                        }
+                        for (int row = row0; row < row1; row++) {
+                                place(rotation, f, col0, row, &dcol, 
+                                      &drow);
+                                blocked_run(dst, dir, dcol, drow, 
+                                            UArray2b_addr(src, col0, row),
+                                            col1 - col0);
+                        }
+                }
+        }
+}
+
+bool Kernels_handles(A2Methods_T methods, A2Methods_UArray2 array)
+{
+        assert(methods != NULL && array != NULL);
+        int size = methods->size(array);
+        return (methods == uarray2_methods_flat || 
+                methods == uarray2_methods_blocked) &&
+               size > 0 && size <= 16;
+}
+
+/* the w x h rectangle of src at (x, y), which lies inside frame f */
+static bool framed(A2Methods_T methods, A2Methods_UArray2 src,
+                   A2Methods_UArray2 dst, int rotation, 
+                   const struct frame *f, int x, int y, int w, int h)
+{
+        if (!Kernels_handles(methods, src) || !Kernels_handles(methods, dst)) {
+                return false;
+        }
+        assert(methods->size(src) == methods->size(dst));
+        if (w <= 0 || h <= 0) {
+                return true;
+        }
+        assert(x >= f->x && y >= f->y);
+        assert(x + w <= f->x + f->width && y + h <= f->y + f->height);
+
+        if (methods == uarray2_methods_flat) {
+                flat_region(src, dst, rotation, f, x, y, w, h);
+        } else {
+                blocked_region(src, dst, rotation, f, x, y, w, h);
+        }
+        return true;
+}
+
+bool Kernels_transform_region(A2Methods_T methods, A2Methods_UArray2 src,
+                              A2Methods_UArray2 dst, int rotation,
+                              int x, int y, int w, int h)
+{
+        struct frame whole = { 0, 0, methods->width(src), 
+                               methods->height(src) };
+        return framed(methods, src, dst, rotation, &whole, x, y, w, h);
+}
+
+bool Kernels_transform_view(A2Methods_T methods, A2Methods_view src,
+                            A2Methods_UArray2 dst, int rotation)
+{
+        assert(src.x >= 0 && src.y >= 0);
+        assert(src.x + src.width <= methods->width(src.parent));
+        assert(src.y + src.height <= methods->height(src.parent));
+        struct frame view = { src.x, src.y, src.width, src.height };
+        return framed(methods, src.parent, dst, rotation, &view, src.x, 
+                      src.y, src.width, src.height);
+}
+
+/*
+ * 0 and the horizontal flip by spans: each row (or, for 0, each block)
+ * of src is copied whole, or reversed, into the same row or block of
+ * dst. False if the suite has neither kind of span
+ */
+static bool span_copy(A2Methods_T methods, A2Methods_UArray2 src,
+                      A2Methods_UArray2 dst, int rotation)
+{
+        int size = methods->size(src);
+        if (rotation == 0 && methods->row_span == NULL &&
+            methods->block_span != NULL) {
+                int blocksize = methods->blocksize(src);
+                int blockswide = (methods->width(src) + blocksize - 1) /
+                                 blocksize;
+                int blockshigh = (methods->height(src) + blocksize - 1) /
+                                 blocksize;
+                for (int by = 0; by < blockshigh; by++) {
+                        for (int bx = 0; bx < blockswide; bx++) {
+                                int stride, w, h;
+                                char *s = methods->block_span(src, bx, by,
+                                                              &stride, &w,
+                                                              &h);
+                                char *d = methods->block_span(dst, bx, by,
+                                                              &stride, &w,
+                                                              &h);
+                                for (int r = 0; r < h; r++) {
+                                        memcpy(d + (size_t)r * stride,
+                                               s + (size_t)r * stride,
+                                               (size_t)w * size);
+                                }
+                        }
+                }
+                return true;
+        }
+        if (methods->row_span == NULL) {
+                return false;
+        }
+        int height = methods->height(src);
+        for (int j = 0; j < height; j++) {
+                int n;
+                const char *s = methods->row_span(src, j, &n);
+                char *d = methods->row_span(dst, j, &n);
+                if (rotation == 0) {
+                        memcpy(d, s, (size_t)n * size);
+                } else {
+                        copy_strided(d + (size_t)(n - 1) * size, s, n, 
+                                     -size, size);
+                }
+        }
+        return true;
+}
+
+bool Kernels_transform(A2Methods_T methods, A2Methods_UArray2 src,
+                       A2Methods_UArray2 dst, int rotation)
+{
+        if ((rotation == 0 || rotation == 360) &&
+            span_copy(methods, src, dst, rotation)) {
+                return true;
+        }
+        return Kernels_transform_region(methods, src, dst, rotation, 0, 0,
+                                        methods->width(src),
+                                        methods->height(src));
+}
@@ -0,0 +1,82 @@
+/*
+ *     kernels.h
+ *
+ *     locality
+ *
+ *     This is the header file for the Kernels interface: one tight loop
+ *     per ppmtrans transform, working directly on the rows of a UArray2f
+ *     or the blocks of a UArray2b instead of calling an apply function
+ *     (and methods->at) for every pixel.
+ *
+ */
+
+#ifndef KERNELS_INCLUDED
+#define KERNELS_INCLUDED
+
+#include <stdbool.h>
+#include "a2methods.h"
+
+
+/**********Kernels_handles********
+ *
+ * Says whether the kernels know how to transform an array
+ * Inputs: the methods suite the array belongs to, and the array
+ * Return: true if the array is a uarray2_methods_flat or
+ *      uarray2_methods_blocked array whose elements are at most 16
+ *      bytes: struct Pnm_rgb, any of the compact pixel formats in
+ *      ppmio.h, or the samples of one plane of a planar image
+ *
+ ************************/
+bool Kernels_handles(A2Methods_T methods, A2Methods_UArray2 array);
+
+
+/**********Kernels_transform********
+ *
+ * Writes a rotated, flipped or transposed copy of src into dst
+ * Inputs: the methods suite both arrays belong to, the source array, the
+ *      destination array, and the rotation as ppmtrans encodes it (a
+ *      Dihedral_T, see dihedral.h)
+ * Return: true if a kernel did the work, false if the arrays aren't ones
+ *      the kernels handle (and nothing was written)
+ * Expects:
+ *      dst to have src's dimensions, swapped when Dihedral_swapsaxes
+ * Notes:
+ *      0 and the horizontal flip are done for any suite with row spans
+ *      (0 also with block spans), as a copy, or reversed copy, of each
+ *      span, whatever the element size
+ *
+ ************************/
+bool Kernels_transform(A2Methods_T methods, A2Methods_UArray2 src,
+                       A2Methods_UArray2 dst, int rotation);
+
+
+/**********Kernels_transform_region********
+ *
+ * Like Kernels_transform, but only moves the w x h rectangle of source
+ * elements whose top left is (x, y)
+ * Expects:
+ *      The rectangle to lie inside src
+ * Notes:
+ *      Different rectangles write disjoint parts of dst
+ *
+ ************************/
+bool Kernels_transform_region(A2Methods_T methods, A2Methods_UArray2 src,
+                              A2Methods_UArray2 dst, int rotation,
+                              int x, int y, int w, int h);
+
+
+/**********Kernels_transform_view********
+ *
+ * Like Kernels_transform, but transforms just a view of src, as if it
+ * were the whole image
+ * Expects:
+ *      The view to lie inside its parent, and dst to have the view's
+ *      dimensions, swapped when Dihedral_swapsaxes
+ * Notes:
+ *      Only the view's pixels are read; nothing is copied out first
+ *
+ ************************/
+bool Kernels_transform_view(A2Methods_T methods, A2Methods_view src,
+                            A2Methods_UArray2 dst, int rotation);
+
+#endif
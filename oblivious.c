@@ -0,0 +1,107 @@
+/*
+ *     oblivious.c
+ *
+ *     locality
+ *
+ *     This is the implementation file for our Oblivious interface.
+ *
+ */
+
+#include <string.h>
+
+#include "assert.h"
+#include "oblivious.h"
+#include "cacheinfo.h"
+#include "kernels.h"
+
+typedef A2Methods_UArray2 A2;
+
+struct job {
+        A2Methods_T methods;
+        A2 src, dst;
+        int rotation;
+        int width, height;  /* of the source */
+        int size;
+        long leaf;          /* most elements a base case tile may hold */
+        bool kernels;       /* base case tiles can go to the kernels */
+};
+
+/* where source element (col, row) ends up in the destination */
+static inline void destination(struct job *job, int col, int row,
+                               int *dcol, int *drow)
+{
+        int w = job->width;
+        int h = job->height;
+        switch (job->rotation) {
+        case 0:   *dcol = col;         *drow = row;         break;
+        case 90:  *dcol = h - row - 1; *drow = col;         break;
+        case 180: *dcol = w - col - 1; *drow = h - row - 1; break;
+        case 270: *dcol = row;         *drow = w - col - 1; break;
+        case 360: *dcol = w - col - 1; *drow = row;         break;
+        case 450: *dcol = col;         *drow = h - row - 1; break;
+        case 540: *dcol = row;         *drow = col;         break;
+        case 630: *dcol = h - row - 1; *drow = w - col - 1; break;
+        default:  assert(0); *dcol = col; *drow = row;
+        }
+}
+
+static void copy_tile(struct job *job, int x, int y, int w, int h)
+{
+        A2Methods_T methods = job->methods;
+        if (job->kernels) {
+                Kernels_transform_region(methods, job->src, job->dst,
+                                         job->rotation, x, y, w, h);
+                return;
+        }
+        for (int row = y; row < y + h; row++) {
+                for (int col = x; col < x + w; col++) {
+                        int dcol, drow;
+                        destination(job, col, row, &dcol, &drow);
+                        memcpy(methods->at(job->dst, dcol, drow),
+                               methods->at(job->src, col, row), job->size);
+                }
+        }
+}
+
+/* transforms the w x h source rectangle whose top left is (x, y) */
+static void recurse(struct job *job, int x, int y, int w, int h)
+{
+        if ((long)w * h <= job->leaf) {
+                copy_tile(job, x, y, w, h);
+        } else if (w >= h) {
+                int half = w / 2;
+                recurse(job, x, y, half, h);
+                recurse(job, x + half, y, w - half, h);
+        } else {
+                int half = h / 2;
+                recurse(job, x, y, w, half);
+                recurse(job, x, y + half, w, h - half);
+        }
+}
+
+void Oblivious_transform(A2Methods_T methods, A2 src, A2 dst, int rotation)
+{
+        assert(methods != NULL && src != NULL && dst != NULL);
+        assert(methods->size(src) == methods->size(dst));
+
+        struct job job;
+        job.methods = methods;
+        job.src = src;
+        job.dst = dst;
+        job.rotation = rotation;
+        job.width = methods->width(src);
+        job.height = methods->height(src);
+        job.size = methods->size(src);
+        job.kernels = Kernels_handles(methods, src) && 
+                      Kernels_handles(methods, dst);
+
+        /* a source tile and its destination tile share L1 */
+        job.leaf = CacheInfo_size(1) / (2 * job.size);
+        if (job.leaf < 1) {
+                job.leaf = 1;
+        }
+
+        if (job.width > 0 && job.height > 0) {
+                recurse(&job, 0, 0, job.width, job.height);
+        }
+}
@@ -0,0 +1,41 @@
+/*
+ *     oblivious.h
+ *
+ *     locality
+ *
+ *     This is the header file for the Oblivious interface, a
+ *     cache-oblivious engine for the ppmtrans rotations, flips and
+ *     transpose.
+ *
+ */
+
+#ifndef OBLIVIOUS_INCLUDED
+#define OBLIVIOUS_INCLUDED
+
+#include "a2methods.h"
+
+
+/**********Oblivious_transform********
+ *
+ * Writes a rotated, flipped or transposed copy of src into dst
+ * Inputs: the methods suite both arrays belong to, the source array, the
+ *      destination array, and the rotation as ppmtrans encodes it (a
+ *      Dihedral_T, see dihedral.h)
+ * Return: nothing
+ * Expects:
+ *      dst to have src's dimensions, swapped when Dihedral_swapsaxes
+ *      Both arrays to have the same element size
+ * Notes:
+ *      Splits the source rectangle (and with it the destination
+ *      rectangle) in half along its longer side until a source tile and
+ *      its destination tile fit in L1 together, then copies that tile.
+ *      Every level of the memory hierarchy sees good locality without
+ *      any block size to tune. Tiles are copied by the Kernels when they
+ *      handle the arrays and through methods->at otherwise, so it works
+ *      with every methods suite
+ *
+ ************************/
+void Oblivious_transform(A2Methods_T methods, A2Methods_UArray2 src,
+                         A2Methods_UArray2 dst, int rotation);
+
+#endif
@@ -0,0 +1,260 @@
+/*
+ *     outofcore.c
+ *
+ *     locality
+ *
+ *     This is the implementation file for our OutOfCore interface.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <unistd.h>
+
+#include "assert.h"
+#include "mem.h"
+#include "pnm.h"
+#include "outofcore.h"
+#include "ppmio.h"
+#include "tilecache.h"
+#include "uarray2b_impl.h"
+#include "cacheinfo.h"
+#include "slab.h"
+#include "dihedral.h"
+
+const Except_T OutOfCore_Failed = { "Can't make a scratch file" };
+const Except_T OutOfCore_Write_Failed = { "Can't write the output" };
+
+struct job {
+        int rotation;
+        int width;              /* of the source */
+        int height;
+        int pixelbytes;
+        UArray2b_T layout;      /* of the destination, in the scratch file */
+        TileCache_T cache;
+};
+
+/* where source pixel (col, row) ends up in the destination */
+static inline void destination(struct job *job, int col, int row,
+                               int *dcol, int *drow)
+{
+        int w = job->width;
+        int h = job->height;
+        switch (job->rotation) {
+        case 0:   *dcol = col;         *drow = row;         break;
+        case 90:  *dcol = h - row - 1; *drow = col;         break;
+        case 180: *dcol = w - col - 1; *drow = h - row - 1; break;
+        case 270: *dcol = row;         *drow = w - col - 1; break;
+        case 360: *dcol = w - col - 1; *drow = row;         break;
+        case 450: *dcol = col;         *drow = h - row - 1; break;
+        case 540: *dcol = row;         *drow = col;         break;
+        case 630: *dcol = h - row - 1; *drow = w - col - 1; break;
+        default:  assert(0); *dcol = col; *drow = row;
+        }
+}
+
+/* which way the destination moves, (dcol, drow), when col or row of the
+   source goes up by one */
+static inline void direction(struct job *job, bool along_row,
+                             int *ddcol, int *ddrow)
+{
+        int col1, row1, col0, row0;
+        destination(job, 0, 0, &col0, &row0);
+        destination(job, along_row, !along_row, &col1, &row1);
+        *ddcol = col1 - col0;
+        *ddrow = row1 - row0;
+}
+
+/* how many steps of (ddcol, ddrow) from (dcol, drow) stay in its block */
+static inline int room(UArray2b_T a, int dcol, int drow, int ddcol,
+                       int ddrow)
+{
+        int cx = UArray2b_cellof(a, dcol);
+        int cy = UArray2b_cellof(a, drow);
+        if (ddcol > 0) {
+                return UArray2b_blockwidth(a, UArray2b_blockof(a, dcol)) - cx;
+        } else if (ddcol < 0) {
+                return cx + 1;
+        } else if (ddrow > 0) {
+                return UArray2b_blockheight(a, UArray2b_blockof(a, drow)) -
+                       cy;
+        } else {
+                return cy + 1;
+        }
+}
+
+static inline void copy_pixel(unsigned char *dst, const unsigned char *src,
+                              int pixelbytes)
+{
+        for (int b = 0; b < pixelbytes; b++) {
+                dst[b] = src[b];
+        }
+}
+
+/*
+ * Moves the rows source rows in band, the first of which is row, into
+ * the destination blocks. No block boundary falls between them, so each
+ * run of columns up to the next boundary is one piece of one block
+ */
+static void scatter_band(struct job *job, const unsigned char *band,
+                         int row, int rows)
+{
+        UArray2b_T a = job->layout;
+        int pb = job->pixelbytes;
+        size_t rowbytes = (size_t)job->width * pb;
+        int xcol, xrow, ycol, yrow;     /* steps for source col, row */
+        direction(job, true, &xcol, &xrow);
+        direction(job, false, &ycol, &yrow);
+
+        for (int col = 0; col < job->width; ) {
+                int dcol, drow;
+                destination(job, col, row, &dcol, &drow);
+                int n = room(a, dcol, drow, xcol, xrow);
+                n = n < job->width - col ? n : job->width - col;
+
+                int bx = UArray2b_blockof(a, dcol);
+                int by = UArray2b_blockof(a, drow);
+                int bw = UArray2b_blockwidth(a, bx);
+                unsigned char *block = (unsigned char *)
+                        TileCache_block(job->cache, bx, by);
+                unsigned char *first = block +
+                        ((size_t)UArray2b_cellof(a, drow) * bw +
+                         UArray2b_cellof(a, dcol)) * pb;
+                ptrdiff_t colstep = ((ptrdiff_t)xrow * bw + xcol) * pb;
+                ptrdiff_t rowstep = ((ptrdiff_t)yrow * bw + ycol) * pb;
+
+                for (int r = 0; r < rows; r++) {
+                        const unsigned char *src = band + r * rowbytes +
+                                                   (size_t)col * pb;
+                        unsigned char *dst = first + r * rowstep;
+                        if (colstep == pb) {
+                                memcpy(dst, src, (size_t)n * pb);
+                                continue;
+                        }
+                        for (int k = 0; k < n; k++) {
+                                copy_pixel(dst + k * colstep, src + k * pb,
+                                           pb);
+                        }
+                }
+                col += n;
+        }
+}
+
+/* reads the source a band at a time and scatters it into the cache */
+static void scatter(FILE *in, struct job *job, unsigned char *buf)
+{
+        size_t rowbytes = (size_t)job->width * job->pixelbytes;
+        int ycol, yrow;
+        direction(job, false, &ycol, &yrow);
+        for (int row = 0; row < job->height; ) {
+                int dcol, drow;
+                destination(job, 0, row, &dcol, &drow);
+                int rows = room(job->layout, dcol, drow, ycol, yrow);
+                rows = rows < job->height - row ? rows : job->height - row;
+                if (fread(buf, rowbytes, rows, in) != (size_t)rows) {
+                        RAISE(Pnm_Badformat);
+                }
+                scatter_band(job, buf, row, rows);
+                row += rows;
+        }
+}
+
+/* reads the scratch file a band of blocks at a time, and writes rows */
+static void gather(FILE *out, int fd, UArray2b_T a, unsigned char *buf,
+                   unsigned char *rowbuf)
+{
+        size_t rowbytes = (size_t)a->width * a->size;
+        for (int by = 0; by < a->blockshigh; by++) {
+                int bh = UArray2b_blockheight(a, by);
+                size_t first = UArray2b_blockstart(a, 0, by);
+                size_t nbytes = bh * rowbytes;
+                TileCache_transfer(fd, buf, nbytes, (off_t)first * a->size,
+                                   false);
+                for (int r = 0; r < bh; r++) {
+                        for (int bx = 0; bx < a->blockswide; bx++) {
+                                int bw = UArray2b_blockwidth(a, bx);
+                                size_t at = UArray2b_blockstart(a, bx, by) -
+                                            first + (size_t)r * bw;
+                                memcpy(rowbuf + (size_t)bx * a->blocksize *
+                                                a->size,
+                                       buf + at * a->size,
+                                       (size_t)bw * a->size);
+                        }
+                        if (fwrite(rowbuf, rowbytes, 1, out) != 1) {
+                                RAISE(OutOfCore_Write_Failed);
+                        }
+                }
+        }
+}
+
+/* an unlinked file in $TMPDIR, or /tmp */
+static int scratch_file(void)
+{
+        const char *dir = getenv("TMPDIR");
+        if (dir == NULL || *dir == '\0') {
+                dir = "/tmp";
+        }
+        const char *name = "/ppmtrans-XXXXXX";
+        char *path = ALLOC(strlen(dir) + strlen(name) + 1);
+        strcpy(path, dir);
+        strcat(path, name);
+        int fd = mkstemp(path);
+        if (fd >= 0) {
+                unlink(path);
+        }
+        FREE(path);
+        if (fd < 0) {
+                RAISE(OutOfCore_Failed);
+        }
+        return fd;
+}
+
+bool OutOfCore_transform(FILE *in, FILE *out, int rotation, size_t budget)
+{
+        assert(in != NULL && out != NULL);
+        int width, height, maxval;
+        if (!PpmIO_read_header(in, &width, &height, &maxval)) {
+                return false;
+        }
+
+        struct job job;
+        job.rotation = rotation;
+        job.width = width;
+        job.height = height;
+        job.pixelbytes = maxval > 255 ? 6 : 3;
+
+        bool swapaxes = Dihedral_swapsaxes(rotation);
+        int dwidth = swapaxes ? height : width;
+        int dheight = swapaxes ? width : height;
+        int blocksize = CacheInfo_blocksize(CacheInfo_default_level(),
+                                            job.pixelbytes);
+        struct UArray2b_T layout = UArray2b_layout(dwidth, dheight,
+                                                   job.pixelbytes,
+                                                   blocksize);
+        job.layout = &layout;
+
+        int fd = scratch_file();
+        job.cache = TileCache_new(fd, &layout, budget);
+
+        /* a band is at most blocksize rows, of either width */
+        int widest = width > dwidth ? width : dwidth;
+        size_t bufbytes = (size_t)blocksize * widest * job.pixelbytes;
+        unsigned char *buf = Slab_alloc(bufbytes);
+
+        scatter(in, &job, buf);
+        TileCache_free(&job.cache);
+
+        unsigned char *rowbuf = ALLOC((size_t)dwidth * job.pixelbytes);
+        fprintf(out, "P6\n%d %d\n%d\n", dwidth, dheight, maxval);
+        gather(out, fd, &layout, buf, rowbuf);
+        if (fflush(out) != 0) {
+                RAISE(OutOfCore_Write_Failed);
+        }
+
+        FREE(rowbuf);
+        Slab_free(buf, bufbytes);
+        close(fd);
+        return true;
+}
@@ -0,0 +1,55 @@
+/*
+ *     outofcore.h
+ *
+ *     locality
+ *
+ *     This is the header file for the OutOfCore interface, which rotates,
+ *     flips or transposes P6 images too big to hold in memory, by way of
+ *     a scratch file.
+ *
+ */
+
+#ifndef OUTOFCORE_INCLUDED
+#define OUTOFCORE_INCLUDED
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "except.h"
+
+/* raised when the scratch file can't be made */
+extern const Except_T OutOfCore_Failed;
+
+/* raised when the output can't be written, e.g. on a full disk */
+extern const Except_T OutOfCore_Write_Failed;
+
+
+/**********OutOfCore_transform********
+ *
+ * Writes a rotated, flipped or transposed copy of the P6 image on in to
+ * out, holding only a bounded part of it in memory
+ * Inputs: input and output files, the rotation as ppmtrans encodes it
+ *      (a Dihedral_T, see dihedral.h), and how many bytes of destination
+ *      blocks to cache in memory
+ * Return: true once the image is written, false if in isn't P6, in which
+ *      case nothing was read
+ * Expects: in and out to be nonnull
+ * Notes:
+ *      The destination goes into an unlinked scratch file in $TMPDIR (or
+ *      /tmp) laid out as a UArray2b of raw 3 or 6 byte pixels, through a
+ *      TileCache, so every scratch write is one whole block. The source
+ *      is read from the top in bands cut where destination blocks begin,
+ *      so each destination block is filled by exactly one band and never
+ *      read back before the end. Then the scratch file is read one band
+ *      of blocks at a time, in order, and encoded row by row. Besides
+ *      the cache, memory use is two bands of blocksize rows, one each of
+ *      the source and destination width. Samples come out exactly as
+ *      they went in. Raises Pnm_Badformat if the input is short or
+ *      malformed, OutOfCore_Failed if there is no scratch file,
+ *      TileCache_Failed if it can't be read or written, and
+ *      OutOfCore_Write_Failed if out can't be written
+ *
+ ************************/
+bool OutOfCore_transform(FILE *in, FILE *out, int rotation, size_t budget);
+
+#endif
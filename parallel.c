@@ -0,0 +1,119 @@
+/*
+ *     parallel.c
+ *
+ *     locality
+ *
+ *     This is the implementation file for our Parallel interface.
+ *
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "assert.h"
+#include "parallel.h"
+#include "a2blocked.h"
+#include "cacheinfo.h"
+#include "kernels.h"
+#include "dihedral.h"
+
+struct job {
+        A2Methods_T methods;
+        A2Methods_UArray2 src;
+        A2Methods_UArray2 dst;
+        int rotation;
+        A2Methods_applyfun *apply;
+        void *cl;
+        bool kernels;       /* the Kernels handle src and dst */
+
+        int width, height;  /* of src */
+        int tilewidth;      /* tiles are tilewidth x tileheight pieces */
+        int tileheight;     /* of src, clipped at its edges */
+        int tileswide;
+};
+
+/*
+ * How many of the n lines (rows or columns) of length across go in one
+ * band: about half an L2 cache's worth, and at least four bands a worker
+ */
+static int band_lines(int n, int across, int size, int nthreads)
+{
+        long linebytes = (long)across * size;
+        int band = linebytes > 0 ? CacheInfo_size(2) / 2 / linebytes : n;
+        int most = (n + 4 * nthreads - 1) / (4 * nthreads);
+        band = band < most ? band : most;
+
+        /* whole groups of four suit the 4 x 4 tile transpose */
+        if (band >= 8) {
+                band &= ~3;
+        }
+        return band > 0 ? band : 1;
+}
+
+static void do_tile(int task, int worker, void *cl)
+{
+        (void)worker;
+        struct job *job = cl;
+        int x = task % job->tileswide * job->tilewidth;
+        int y = task / job->tileswide * job->tileheight;
+        int w = job->width - x < job->tilewidth
+              ? job->width - x : job->tilewidth;
+        int h = job->height - y < job->tileheight
+              ? job->height - y : job->tileheight;
+
+        if (job->kernels) {
+                Kernels_transform_region(job->methods, job->src, job->dst,
+                                         job->rotation, x, y, w, h);
+                return;
+        }
+        for (int row = y; row < y + h; row++) {
+                for (int col = x; col < x + w; col++) {
+                        job->apply(col, row, job->src,
+                                   job->methods->at(job->src, col, row),
+                                   job->cl);
+                }
+        }
+}
+
+void Parallel_transform(Threadpool_T pool, A2Methods_T methods,
+                        A2Methods_UArray2 src, A2Methods_UArray2 dst,
+                        int rotation, A2Methods_applyfun *apply, void *cl)
+{
+        assert(pool != NULL && methods != NULL);
+        assert(src != NULL && dst != NULL && apply != NULL);
+
+        struct job job;
+        job.methods  = methods;
+        job.src      = src;
+        job.dst      = dst;
+        job.rotation = rotation;
+        job.apply    = apply;
+        job.cl       = cl;
+        job.kernels  = Kernels_handles(methods, src) &&
+                       Kernels_handles(methods, dst);
+        job.width    = methods->width(src);
+        job.height   = methods->height(src);
+        if (job.width == 0 || job.height == 0) {
+                return;
+        }
+
+        int size = methods->size(src);
+        int nthreads = Threadpool_size(pool);
+        if (methods == uarray2_methods_blocked) {
+                job.tilewidth = job.tileheight = methods->blocksize(src);
+        } else if (Dihedral_swapsaxes(rotation)) {
+                /* source columns become destination rows, so bands of
+                   columns let each task fill whole destination rows */
+                job.tilewidth = band_lines(job.width, job.height, size,
+                                           nthreads);
+                job.tileheight = job.height;
+        } else {
+                job.tilewidth = job.width;
+                job.tileheight = band_lines(job.height, job.width, size,
+                                            nthreads);
+        }
+        job.tileswide = (job.width + job.tilewidth - 1) / job.tilewidth;
+        int tileshigh = (job.height + job.tileheight - 1) / job.tileheight;
+
+        Threadpool_run(pool, job.tileswide * tileshigh, do_tile, &job);
+}
@@ -0,0 +1,47 @@
+/*
+ *     parallel.h
+ *
+ *     locality
+ *
+ *     This is the header file for the Parallel interface, which runs a
+ *     ppmtrans transform on every worker of a Threadpool at once.
+ *
+ */
+
+#ifndef PARALLEL_INCLUDED
+#define PARALLEL_INCLUDED
+
+#include "a2methods.h"
+#include "threadpool.h"
+
+
+/**********Parallel_transform********
+ *
+ * Writes a rotated, flipped or transposed copy of src into dst using
+ * every worker in pool
+ * Inputs: the pool, the methods suite both arrays belong to, the source
+ *      array, the destination array, the rotation as ppmtrans encodes it
+ *      (a Dihedral_T, see dihedral.h), and an apply function and closure
+ *      that move one element the same way
+ * Return: nothing
+ * Expects:
+ *      dst to have src's dimensions, swapped when Dihedral_swapsaxes
+ *      apply to be safe to call from several threads at once, as long as
+ *      they write different elements
+ * Notes:
+ *      The source is cut into tasks: one per block for
+ *      uarray2_methods_blocked, and bands for everything else. The bands
+ *      are whole rows, except for 90, 270 and transpose, where they are
+ *      whole columns so that each task fills whole destination rows.
+ *      Each task moves its piece with the Kernels when they handle the
+ *      arrays, and by calling apply on each element when they don't.
+ *      Tasks cover disjoint parts of the source, so they write disjoint
+ *      parts of dst. The destination pages a worker touches first are
+ *      the ones it writes, so on NUMA machines they end up near it
+ *
+ ************************/
+void Parallel_transform(Threadpool_T pool, A2Methods_T methods,
+                        A2Methods_UArray2 src, A2Methods_UArray2 dst,
+                        int rotation, A2Methods_applyfun *apply, void *cl);
+
+#endif
@@ -0,0 +1,814 @@
+/*
+ *     ppmio.c
+ *
+ *     locality
+ *
+ *     This is the implementation file for our PpmIO interface.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <ctype.h>
+#include <limits.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "assert.h"
+#include "except.h"
+#include "mem.h"
+#include "ppmio.h"
+#include "a2blocked.h"
+#include "uarray2b_impl.h"
+#include "simd.h"
+#include "slab.h"
+
+typedef struct Pnm_rgb Pixel;
+
+/* about how much pixel data to read from a pipe, or write, at a time */
+#define CHUNK (1 << 20)
+
+/* where decoded rows go */
+struct sink {
+        A2Methods_T methods;
+        A2Methods_UArray2 array;
+        int width;
+        int size;               /* element size, so pixel format */
+        bool wide;              /* 2 byte samples (maxval > 255) */
+        Simd_widenfun *widen;
+        A2Methods_UArray2 *planes;      /* red, green, blue; or NULL */
+};
+
+/*
+ * Reads a header number, skipping whitespace and # comments before it.
+ * The whitespace character after it is consumed too. Returns false if
+ * there is no well formed number there
+ */
+static bool scan_number(FILE *fp, int *number)
+{
+        int c = getc(fp);
+        for (;;) {
+                if (c == '#') {
+                        while (c != '\n' && c != EOF) {
+                                c = getc(fp);
+                        }
+                } else if (c != EOF && isspace(c)) {
+                        c = getc(fp);
+                } else {
+                        break;
+                }
+        }
+        if (c == EOF || !isdigit(c)) {
+                return false;
+        }
+
+        long n = 0;
+        for (; c != EOF && isdigit(c); c = getc(fp)) {
+                n = n * 10 + (c - '0');
+                if (n > INT_MAX) {
+                        return false;
+                }
+        }
+        if (c == '#') {
+                ungetc(c, fp);
+        } else if (c == EOF || !isspace(c)) {
+                return false;
+        }
+        *number = n;
+        return true;
+}
+
+/* scan_number, raising Pnm_Badformat if there is no number */
+static int read_number(FILE *fp)
+{
+        int n;
+        if (!scan_number(fp, &n)) {
+                RAISE(Pnm_Badformat);
+        }
+        return n;
+}
+
+/* n pixels of samples at src into elements of sink's format at dst */
+static inline void decode(struct sink *sink, void *dst,
+                          const unsigned char *src, int n)
+{
+        if (sink->size == PPMIO_PNM_RGB) {
+                Pixel *p = dst;
+                if (!sink->wide) {
+                        sink->widen(p, src, n);
+                        return;
+                }
+                for (int k = 0; k < n; k++, src += 6) {
+                        p[k].red   = src[0] << 8 | src[1];
+                        p[k].green = src[2] << 8 | src[3];
+                        p[k].blue  = src[4] << 8 | src[5];
+                }
+        } else if (sink->size == PPMIO_RGB8) {
+                memcpy(dst, src, (size_t)n * 3);
+        } else if (sink->size == PPMIO_RGBX8) {
+                unsigned char *d = dst;
+                for (int k = 0; k < n; k++, src += 3, d += 4) {
+                        d[0] = src[0];
+                        d[1] = src[1];
+                        d[2] = src[2];
+                        d[3] = 0;
+                }
+        } else {
+                /* PPMIO_RGB16 or PPMIO_RGBX16, big endian to native */
+                uint16_t *d = dst;
+                int step = sink->size / 2;
+                for (int k = 0; k < n; k++, src += 6, d += step) {
+                        d[0] = src[0] << 8 | src[1];
+                        d[1] = src[2] << 8 | src[3];
+                        d[2] = src[4] << 8 | src[5];
+                        if (step == 4) {
+                                d[3] = 0;
+                        }
+                }
+        }
+}
+
+/* decodes the bytes of row j into the array */
+static void store_row(struct sink *sink, int j, const unsigned char *bytes)
+{
+        A2Methods_T methods = sink->methods;
+        int pixelbytes = sink->wide ? 6 : 3;
+
+        if (methods->row_span != NULL) {
+                int n;
+                void *row = methods->row_span(sink->array, j, &n);
+                decode(sink, row, bytes, n);
+        } else {
+                for (int i = 0; i < sink->width; i++) {
+                        decode(sink, methods->at(sink->array, i, j),
+                               bytes + (size_t)i * pixelbytes, 1);
+                }
+        }
+}
+
+/*
+ * How many elements starting at (i, j) lie one after another in memory:
+ * the rest of the row for arrays with row spans, the rest of the row of
+ * i's block for blocked ones, and just the one for anything else
+ */
+static int contiguous(A2Methods_T methods, A2Methods_UArray2 array, int i,
+                      int width)
+{
+        if (methods->row_span != NULL) {
+                return width - i;
+        } else if (methods == uarray2_methods_blocked) {
+                UArray2b_T a = array;
+                return UArray2b_blockwidth(a, UArray2b_blockof(a, i)) -
+                       UArray2b_cellof(a, i);
+        }
+        return 1;
+}
+
+/* channel c of the n pixels from pixel i of a row of samples, into dst */
+static inline void split(bool wide, void *dst, const unsigned char *row,
+                         int i, int n, int c)
+{
+        if (wide) {
+                uint16_t *d = dst;
+                const unsigned char *s = row + (size_t)i * 6 + 2 * c;
+                for (int k = 0; k < n; k++, s += 6) {
+                        d[k] = s[0] << 8 | s[1];
+                }
+        } else {
+                unsigned char *d = dst;
+                const unsigned char *s = row + (size_t)i * 3 + c;
+                for (int k = 0; k < n; k++, s += 3) {
+                        d[k] = *s;
+                }
+        }
+}
+
+/* the reverse: n samples of channel c at src into a row of samples */
+static inline void merge(bool wide, unsigned char *row, const void *src,
+                         int i, int n, int c)
+{
+        if (wide) {
+                const uint16_t *s = src;
+                unsigned char *d = row + (size_t)i * 6 + 2 * c;
+                for (int k = 0; k < n; k++, d += 6) {
+                        d[0] = s[k] >> 8;
+                        d[1] = s[k];
+                }
+        } else {
+                const unsigned char *s = src;
+                unsigned char *d = row + (size_t)i * 3 + c;
+                for (int k = 0; k < n; k++, d += 3) {
+                        *d = s[k];
+                }
+        }
+}
+
+/* splits the samples of row j into the three planes */
+static void store_planar_row(struct sink *sink, int j,
+                             const unsigned char *bytes)
+{
+        A2Methods_T methods = sink->methods;
+        for (int c = 0; c < 3; c++) {
+                A2Methods_UArray2 plane = sink->planes[c];
+                for (int i = 0; i < sink->width; ) {
+                        int n = contiguous(methods, plane, i, sink->width);
+                        split(sink->wide, methods->at(plane, i, j), bytes,
+                              i, n, c);
+                        i += n;
+                }
+        }
+}
+
+/*
+ * Decodes rows j .. j + n - 1, whose bytes follow one another rowbytes
+ * apart. A UArray2b gets them a block at a time, so when the rows are a
+ * band of blocks each block is filled front to back
+ */
+static void store_rows(struct sink *sink, int j, int n,
+                       const unsigned char *bytes, size_t rowbytes)
+{
+        if (sink->planes != NULL) {
+                for (int k = 0; k < n; k++) {
+                        store_planar_row(sink, j + k, bytes + k * rowbytes);
+                }
+                return;
+        }
+        if (sink->methods != uarray2_methods_blocked) {
+                for (int k = 0; k < n; k++) {
+                        store_row(sink, j + k, bytes + k * rowbytes);
+                }
+                return;
+        }
+        UArray2b_T a = sink->array;
+        int pixelbytes = sink->wide ? 6 : 3;
+        for (int bx = 0; bx < a->blockswide; bx++) {
+                int i = bx * a->blocksize;
+                int bw = UArray2b_blockwidth(a, bx);
+                for (int k = 0; k < n; k++) {
+                        decode(sink, UArray2b_addr(a, i, j + k),
+                               bytes + k * rowbytes + (size_t)i * pixelbytes,
+                               bw);
+                }
+        }
+}
+
+/*
+ * How many rows to take in at a time: one band of blocks for a UArray2b,
+ * else about a CHUNK (and at least one row)
+ */
+static int band_rows(struct sink *sink, int height, size_t rowbytes)
+{
+        int rows;
+        if (sink->methods == uarray2_methods_blocked && 
+            sink->planes == NULL) {
+                rows = ((UArray2b_T)sink->array)->blocksize;
+        } else {
+                rows = CHUNK / rowbytes > 0 ? CHUNK / rowbytes : 1;
+        }
+        return rows < height ? rows : height;
+}
+
+/*
+ * Decodes the pixels in place from a mapping of the file, and leaves fp
+ * just past them. Returns false (having read nothing) if fp isn't a
+ * regular file that can be mapped. Each band's pages are dropped once it
+ * is decoded, so the mapping never holds more than a band or so in memory
+ */
+static bool read_mapped(FILE *fp, struct sink *sink, int height,
+                        size_t rowbytes)
+{
+        struct stat st;
+        long offset = ftell(fp);
+        if (offset < 0 || fstat(fileno(fp), &st) != 0 ||
+            !S_ISREG(st.st_mode)) {
+                return false;
+        }
+        size_t end = offset + rowbytes * height;
+        if ((size_t)st.st_size < end) {
+                RAISE(Pnm_Badformat);
+        }
+        unsigned char *map = mmap(NULL, end, PROT_READ, MAP_PRIVATE,
+                                  fileno(fp), 0);
+        if (map == MAP_FAILED) {
+                return false;
+        }
+        madvise(map, end, MADV_SEQUENTIAL);
+
+        size_t pagesize = sysconf(_SC_PAGESIZE);
+        size_t dropped = 0;
+        int rows = band_rows(sink, height, rowbytes);
+        for (int j = 0; j < height; j += rows) {
+                int n = height - j < rows ? height - j : rows;
+                size_t start = offset + j * rowbytes;
+                store_rows(sink, j, n, map + start, rowbytes);
+
+                /* the file is still there, so read-only pages can go */
+                size_t done = (start + n * rowbytes) / pagesize * pagesize;
+                if (done > dropped) {
+                        madvise(map + dropped, done - dropped, 
+                                MADV_DONTNEED);
+                        dropped = done;
+                }
+        }
+        munmap(map, end);
+        fseek(fp, end, SEEK_SET);
+        return true;
+}
+
+/* reads the pixels a band at a time into one band of staging */
+static void read_streamed(FILE *fp, struct sink *sink, int height,
+                          size_t rowbytes)
+{
+        int rows = band_rows(sink, height, rowbytes);
+        unsigned char *buf = ALLOC(rows * rowbytes);
+
+        for (int j = 0; j < height; j += rows) {
+                int n = height - j < rows ? height - j : rows;
+                if (fread(buf, rowbytes, n, fp) != (size_t)n) {
+                        FREE(buf);
+                        RAISE(Pnm_Badformat);
+                }
+                store_rows(sink, j, n, buf, rowbytes);
+        }
+        FREE(buf);
+}
+
+/*
+ * Reads the magic number if it is P6, and pushes it back (glibc takes
+ * back both characters) if it isn't
+ */
+static bool read_magic(FILE *fp)
+{
+        int c1 = getc(fp);
+        int c2 = getc(fp);
+        if (c1 == 'P' && c2 == '6') {
+                return true;
+        }
+        if (c2 != EOF) {
+                ungetc(c2, fp);
+        }
+        if (c1 != EOF) {
+                ungetc(c1, fp);
+        }
+        return false;
+}
+
+/* the rest of a P6 header, after the magic number */
+static void read_header(FILE *fp, int *width, int *height, int *maxval)
+{
+        *width = read_number(fp);
+        *height = read_number(fp);
+        *maxval = read_number(fp);
+        if (*width <= 0 || *height <= 0 || *maxval <= 0 || 
+            *maxval > 65535) {
+                RAISE(Pnm_Badformat);
+        }
+}
+
+bool PpmIO_check(FILE *fp)
+{
+        assert(fp != NULL);
+        struct stat st;
+        int width, height, maxval;
+        bool ok = fstat(fileno(fp), &st) == 0 && S_ISREG(st.st_mode) &&
+                  read_magic(fp) && scan_number(fp, &width) && 
+                  scan_number(fp, &height) && scan_number(fp, &maxval) &&
+                  width > 0 && height > 0 && maxval > 0 && maxval <= 65535;
+        if (ok) {
+                long offset = ftell(fp);
+                uint64_t end = (uint64_t)width * height * 
+                               (maxval > 255 ? 6 : 3);
+                ok = offset >= 0 && offset <= st.st_size &&
+                     end <= (uint64_t)st.st_size - (uint64_t)offset;
+        }
+        rewind(fp);
+        return ok;
+}
+
+bool PpmIO_read_header(FILE *fp, int *width, int *height, int *maxval)
+{
+        assert(fp != NULL && width != NULL && height != NULL && 
+               maxval != NULL);
+        if (!read_magic(fp)) {
+                return false;
+        }
+        read_header(fp, width, height, maxval);
+        return true;
+}
+
+/* every pixel of the image, from a mapping if possible */
+static void read_pixels(FILE *fp, struct sink *sink, int height)
+{
+        size_t rowbytes = (size_t)sink->width * (sink->wide ? 6 : 3);
+        if (!read_mapped(fp, sink, height, rowbytes)) {
+                read_streamed(fp, sink, height, rowbytes);
+        }
+}
+
+/* reads into elements of size bytes, or of the narrowest format if size
+   is 0 (and padded ones if padded is set), taking *spare for them if it
+   has the right shape */
+static Pnm_ppm read_format(FILE *fp, A2Methods_T methods, int size,
+                           bool padded, A2Methods_UArray2 *spare)
+{
+        assert(fp != NULL && methods != NULL);
+        assert(methods->new != NULL && methods->at != NULL);
+
+        if (!read_magic(fp)) {
+                return Pnm_ppmread(fp, methods);
+        }
+        int width, height, maxval;
+        read_header(fp, &width, &height, &maxval);
+        if (size == 0 && maxval > 255) {
+                size = padded ? PPMIO_RGBX16 : PPMIO_RGB16;
+        } else if (size == 0) {
+                size = padded ? PPMIO_RGBX8 : PPMIO_RGB8;
+        }
+
+        Pnm_ppm ppm;
+        NEW(ppm);
+        ppm->width = width;
+        ppm->height = height;
+        ppm->denominator = maxval;
+        ppm->methods = methods;
+        if (spare != NULL && *spare != NULL &&
+            methods->width(*spare) == width &&
+            methods->height(*spare) == height &&
+            methods->size(*spare) == size) {
+                ppm->pixels = *spare;
+                *spare = NULL;
+        } else {
+                ppm->pixels = methods->new(width, height, size);
+        }
+
+        struct sink sink = { methods, ppm->pixels, width, size, 
+                             maxval > 255, Simd_widen_rgb8(), NULL };
+        read_pixels(fp, &sink, height);
+        return ppm;
+}
+
+Pnm_ppm PpmIO_read(FILE *fp, A2Methods_T methods)
+{
+        return read_format(fp, methods, PPMIO_PNM_RGB, false, NULL);
+}
+
+Pnm_ppm PpmIO_read_compact(FILE *fp, A2Methods_T methods, bool padded)
+{
+        return read_format(fp, methods, 0, padded, NULL);
+}
+
+Pnm_ppm PpmIO_read_reusing(FILE *fp, A2Methods_T methods, int size,
+                           bool padded, A2Methods_UArray2 *spare)
+{
+        assert(size == 0 || size == PPMIO_PNM_RGB);
+        assert(spare != NULL);
+        return read_format(fp, methods, size, padded, spare);
+}
+
+static void new_planes(PpmIO_planar image, A2Methods_T methods)
+{
+        int size = image->denominator > 255 ? 2 : 1;
+        for (int c = 0; c < 3; c++) {
+                image->planes[c] = methods->new(image->width, image->height,
+                                                size);
+        }
+}
+
+/* a pixmap netpbm read, split into planes a pixel at a time */
+static void split_pixmap(PpmIO_planar image, Pnm_ppm ppm)
+{
+        A2Methods_T methods = image->methods;
+        bool wide = ppm->denominator > 255;
+        for (unsigned j = 0; j < ppm->height; j++) {
+                for (unsigned i = 0; i < ppm->width; i++) {
+                        Pixel *p = methods->at(ppm->pixels, i, j);
+                        unsigned samples[3] = { p->red, p->green, p->blue };
+                        for (int c = 0; c < 3; c++) {
+                                void *s = methods->at(image->planes[c], i, 
+                                                      j);
+                                if (wide) {
+                                        *(uint16_t *)s = samples[c];
+                                } else {
+                                        *(unsigned char *)s = samples[c];
+                                }
+                        }
+                }
+        }
+}
+
+PpmIO_planar PpmIO_read_planar(FILE *fp, A2Methods_T methods)
+{
+        assert(fp != NULL && methods != NULL);
+        assert(methods->new != NULL && methods->at != NULL);
+        PpmIO_planar image;
+        NEW(image);
+        image->methods = methods;
+
+        if (!read_magic(fp)) {
+                Pnm_ppm ppm = Pnm_ppmread(fp, methods);
+                image->width = ppm->width;
+                image->height = ppm->height;
+                image->denominator = ppm->denominator;
+                new_planes(image, methods);
+                split_pixmap(image, ppm);
+                Pnm_ppmfree(&ppm);
+                return image;
+        }
+        int width, height, maxval;
+        read_header(fp, &width, &height, &maxval);
+        image->width = width;
+        image->height = height;
+        image->denominator = maxval;
+        new_planes(image, methods);
+
+        struct sink sink = { methods, NULL, width, maxval > 255 ? 2 : 1,
+                             maxval > 255, NULL, image->planes };
+        read_pixels(fp, &sink, height);
+        return image;
+}
+
+void PpmIO_planar_free(PpmIO_planar *image)
+{
+        assert(image != NULL && *image != NULL);
+        for (int c = 0; c < 3; c++) {
+                (*image)->methods->free(&(*image)->planes[c]);
+        }
+        FREE(*image);
+}
+
+/* n elements of size bytes at src into samples at dst */
+static inline void encode(Simd_narrowfun *narrow, bool wide, int size,
+                          unsigned char *dst, const void *src, int n)
+{
+        if (size == PPMIO_PNM_RGB) {
+                const Pixel *p = src;
+                if (!wide) {
+                        narrow(dst, p, n);
+                        return;
+                }
+                for (int k = 0; k < n; k++, dst += 6) {
+                        dst[0] = p[k].red >> 8;
+                        dst[1] = p[k].red;
+                        dst[2] = p[k].green >> 8;
+                        dst[3] = p[k].green;
+                        dst[4] = p[k].blue >> 8;
+                        dst[5] = p[k].blue;
+                }
+        } else if (size == PPMIO_RGB8) {
+                memcpy(dst, src, (size_t)n * 3);
+        } else if (size == PPMIO_RGBX8) {
+                const unsigned char *s = src;
+                for (int k = 0; k < n; k++, s += 4, dst += 3) {
+                        dst[0] = s[0];
+                        dst[1] = s[1];
+                        dst[2] = s[2];
+                }
+        } else {
+                const uint16_t *s = src;
+                int step = size / 2;
+                for (int k = 0; k < n; k++, s += step) {
+                        for (int c = 0; c < 3; c++) {
+                                if (wide) {
+                                        *dst++ = s[c] >> 8;
+                                }
+                                *dst++ = s[c];
+                        }
+                }
+        }
+}
+
+/* a band of blocks at a time, each block read in storage order */
+static void write_blocked(FILE *fp, UArray2b_T a, bool wide)
+{
+        int size = a->size;
+        Simd_narrowfun *narrow = Simd_narrow_rgb8();
+        int pixelbytes = wide ? 6 : 3;
+        size_t rowbytes = (size_t)a->width * pixelbytes;
+        unsigned char *buf = Slab_alloc(a->blocksize * rowbytes);
+
+        for (int by = 0; by < a->blockshigh; by++) {
+                int bh = UArray2b_blockheight(a, by);
+                for (int bx = 0; bx < a->blockswide; bx++) {
+                        int bw = UArray2b_blockwidth(a, bx);
+                        const char *block = a->elems + 
+                                UArray2b_blockstart(a, bx, by) * size;
+                        unsigned char *out = buf + (size_t)bx * a->blocksize
+                                                        * pixelbytes;
+                        for (int r = 0; r < bh; r++, out += rowbytes) {
+                                encode(narrow, wide, size, out,
+                                       block + (size_t)r * bw * size, bw);
+                        }
+                }
+                fwrite(buf, rowbytes, bh, fp);
+        }
+        Slab_free(buf, a->blocksize * rowbytes);
+}
+
+/* any other suite, a row span at a time if it has them */
+static void write_rows(FILE *fp, Pnm_ppm pixmap, bool wide)
+{
+        A2Methods_T methods = pixmap->methods;
+        Simd_narrowfun *narrow = Simd_narrow_rgb8();
+        int width = pixmap->width;
+        int height = pixmap->height;
+        int pixelbytes = wide ? 6 : 3;
+        size_t rowbytes = (size_t)width * pixelbytes;
+        int rows = CHUNK / rowbytes > 0 ? CHUNK / rowbytes : 1;
+        rows = rows < height ? rows : height;
+        unsigned char *buf = Slab_alloc(rows * rowbytes);
+        int size = methods->size(pixmap->pixels);
+
+        for (int j = 0; j < height; ) {
+                int n = height - j < rows ? height - j : rows;
+                unsigned char *out = buf;
+                for (int k = 0; k < n; k++, j++, out += rowbytes) {
+                        if (methods->row_span != NULL) {
+                                int length;
+                                void *row = methods->row_span(pixmap->pixels,
+                                                              j, &length);
+                                encode(narrow, wide, size, out, row, length);
+                                continue;
+                        }
+                        for (int i = 0; i < width; i++) {
+                                encode(narrow, wide, size,
+                                       out + i * pixelbytes,
+                                       methods->at(pixmap->pixels, i, j),
+                                       1);
+                        }
+                }
+                fwrite(buf, rowbytes, n, fp);
+        }
+        Slab_free(buf, rows * rowbytes);
+}
+
+void PpmIO_write(FILE *fp, Pnm_ppm pixmap)
+{
+        assert(fp != NULL && pixmap != NULL);
+        A2Methods_T methods = pixmap->methods;
+        assert(methods != NULL && methods->at != NULL);
+        assert(pixmap->width > 0 && pixmap->height > 0);
+        assert(pixmap->denominator > 0 && pixmap->denominator <= 65535);
+        int size = methods->size(pixmap->pixels);
+        bool wide = pixmap->denominator > 255;
+        assert(size == PPMIO_PNM_RGB || size == PPMIO_RGB16 ||
+               size == PPMIO_RGBX16 || (!wide && (size == PPMIO_RGB8 ||
+                                                  size == PPMIO_RGBX8)));
+
+        fprintf(fp, "P6\n%u %u\n%u\n", pixmap->width, pixmap->height,
+                pixmap->denominator);
+        if (methods == uarray2_methods_blocked) {
+                write_blocked(fp, pixmap->pixels, wide);
+        } else {
+                write_rows(fp, pixmap, wide);
+        }
+}
+
+void PpmIO_write_planar(FILE *fp, PpmIO_planar image)
+{
+        assert(fp != NULL && image != NULL);
+        A2Methods_T methods = image->methods;
+        assert(image->width > 0 && image->height > 0);
+        assert(image->denominator > 0 && image->denominator <= 65535);
+        bool wide = image->denominator > 255;
+        assert(methods->size(image->planes[0]) == (wide ? 2 : 1));
+
+        int width = image->width;
+        int height = image->height;
+        size_t rowbytes = (size_t)width * (wide ? 6 : 3);
+        int rows = CHUNK / rowbytes > 0 ? CHUNK / rowbytes : 1;
+        rows = rows < height ? rows : height;
+        unsigned char *buf = Slab_alloc(rows * rowbytes);
+
+        fprintf(fp, "P6\n%u %u\n%u\n", image->width, image->height,
+                image->denominator);
+        for (int j = 0; j < height; ) {
+                int n = height - j < rows ? height - j : rows;
+                unsigned char *out = buf;
+                for (int k = 0; k < n; k++, j++, out += rowbytes) {
+                        for (int c = 0; c < 3; c++) {
+                                A2Methods_UArray2 plane = image->planes[c];
+                                for (int i = 0; i < width; ) {
+                                        int m = contiguous(methods, plane,
+                                                           i, width);
+                                        merge(wide, out,
+                                              methods->at(plane, i, j),
+                                              i, m, c);
+                                        i += m;
+                                }
+                        }
+                }
+                fwrite(buf, rowbytes, n, fp);
+        }
+        Slab_free(buf, rows * rowbytes);
+}
+
+/* reverses the order of the width pixels (of pixelbytes each) in a row */
+static void reverse_pixels(unsigned char *row, int width, int pixelbytes)
+{
+        unsigned char tmp[6];
+        unsigned char *left = row;
+        unsigned char *right = row + (size_t)(width - 1) * pixelbytes;
+        for (; left < right; left += pixelbytes, right -= pixelbytes) {
+                memcpy(tmp, left, pixelbytes);
+                memcpy(left, right, pixelbytes);
+                memcpy(right, tmp, pixelbytes);
+        }
+}
+
+/* 0 and flip horizontal: bands in order, each row flipped if need be */
+static void stream_forward(FILE *in, FILE *out, unsigned char *buf,
+                           int rows, int height, int width, int pixelbytes,
+                           bool flip)
+{
+        size_t rowbytes = (size_t)width * pixelbytes;
+        for (int j = 0; j < height; j += rows) {
+                int n = height - j < rows ? height - j : rows;
+                if (fread(buf, rowbytes, n, in) != (size_t)n) {
+                        RAISE(Pnm_Badformat);
+                }
+                for (int k = 0; flip && k < n; k++) {
+                        reverse_pixels(buf + k * rowbytes, width, 
+                                       pixelbytes);
+                }
+                fwrite(buf, rowbytes, n, out);
+        }
+}
+
+/*
+ * 180 and flip vertical: bands from the bottom of the file up, read with
+ * pread so the stream's own position isn't disturbed, and each band's
+ * rows put in reverse order (and, for 180, each row flipped) in place
+ */
+static void stream_backward(FILE *in, FILE *out, unsigned char *buf,
+                            int rows, int height, int width, 
+                            int pixelbytes, bool flip)
+{
+        size_t rowbytes = (size_t)width * pixelbytes;
+        long offset = ftell(in);
+        unsigned char *tmp = ALLOC(rowbytes);
+
+        for (int end = height; end > 0; end -= rows) {
+                int n = end < rows ? end : rows;
+                size_t nbytes = n * rowbytes;
+                off_t from = offset + (off_t)(end - n) * rowbytes;
+                if (pread(fileno(in), buf, nbytes, from) != (ssize_t)nbytes) {
+                        FREE(tmp);
+                        RAISE(Pnm_Badformat);
+                }
+                for (int k = 0; k < n / 2; k++) {
+                        unsigned char *top = buf + k * rowbytes;
+                        unsigned char *bottom = buf + (n - 1 - k) * rowbytes;
+                        memcpy(tmp, top, rowbytes);
+                        memcpy(top, bottom, rowbytes);
+                        memcpy(bottom, tmp, rowbytes);
+                }
+                for (int k = 0; flip && k < n; k++) {
+                        reverse_pixels(buf + k * rowbytes, width, 
+                                       pixelbytes);
+                }
+                fwrite(buf, rowbytes, n, out);
+        }
+        FREE(tmp);
+        fseek(in, offset + (off_t)height * rowbytes, SEEK_SET);
+}
+
+bool PpmIO_stream(FILE *in, FILE *out, int rotation)
+{
+        assert(in != NULL && out != NULL);
+        bool backward = rotation == 180 || rotation == 450;
+        if (!(backward || rotation == 0 || rotation == 360)) {
+                return false;
+        }
+        struct stat st;
+        if (backward && (fstat(fileno(in), &st) != 0 || 
+                         !S_ISREG(st.st_mode))) {
+                return false;
+        }
+        if (!read_magic(in)) {
+                return false;
+        }
+
+        int width, height, maxval;
+        read_header(in, &width, &height, &maxval);
+        int pixelbytes = maxval > 255 ? 6 : 3;
+        size_t rowbytes = (size_t)width * pixelbytes;
+        int rows = CHUNK / rowbytes > 0 ? CHUNK / rowbytes : 1;
+        rows = rows < height ? rows : height;
+        unsigned char *buf = Slab_alloc(rows * rowbytes);
+
+        fprintf(out, "P6\n%d %d\n%d\n", width, height, maxval);
+        bool flip = rotation == 180 || rotation == 360;
+        if (backward) {
+                stream_backward(in, out, buf, rows, height, width,
+                                pixelbytes, flip);
+        } else {
+                stream_forward(in, out, buf, rows, height, width,
+                               pixelbytes, flip);
+        }
+        Slab_free(buf, rows * rowbytes);
+        return true;
+}
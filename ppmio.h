@@ -0,0 +1,229 @@
+/*
+ *     ppmio.h
+ *
+ *     locality
+ *
+ *     This is the header file for the PpmIO interface, our own reader
+ *     and writer for raw (P6) portable pixmaps. They work straight on
+ *     the storage of an A2 array instead of going through netpbm's
+ *     pixel** and a methods->at or apply call per pixel.
+ *
+ */
+
+#ifndef PPMIO_INCLUDED
+#define PPMIO_INCLUDED
+
+#include <stdio.h>
+#include <stdbool.h>
+#include "a2methods.h"
+#include "pnm.h"
+
+/*
+ * The pixel formats the reader can store, each known by its element size.
+ * Samples are in red, green, blue order, and 16 bit ones are native
+ * endian. The padded formats add a zero fourth sample, so every pixel
+ * starts on a 4 or 8 byte boundary
+ */
+#define PPMIO_RGB8    3                 /* unsigned char samples */
+#define PPMIO_RGBX8   4
+#define PPMIO_RGB16   6                 /* uint16_t samples */
+#define PPMIO_RGBX16  8
+#define PPMIO_PNM_RGB ((int)sizeof(struct Pnm_rgb))  /* unsigned samples */
+
+
+/**********PpmIO_read********
+ *
+ * Reads a portable pixmap into a new A2 array
+ * Inputs: an open file (or stdin), and the methods suite the pixels
+ *      should be stored with
+ * Return: a Pnm_ppm like Pnm_ppmread returns, to be freed with
+ *      Pnm_ppmfree
+ * Expects: fp and methods to be nonnull
+ * Notes:
+ *      Raw P6 input (with 1 or 2 byte samples) is decoded here. When fp
+ *      is a regular file its pixels are mmap'd and decoded in place;
+ *      otherwise they are read a megabyte or so at a time. Each row of
+ *      bytes is widened into pixels with the SIMD widen function, right
+ *      into a UArray2f row or a UArray2 row. Other suites get one
+ *      methods->at per pixel. A UArray2b takes its input one band of
+ *      blocks (blocksize rows) at a time, filling each block in turn,
+ *      so at most one band of input is ever staged or kept mapped
+ *      Any other format (plain P3, say) is handed to Pnm_ppmread.
+ *      Raises Pnm_Badformat if the header is malformed or the pixels
+ *      are cut short. Leaves fp just past the image
+ *
+ ************************/
+Pnm_ppm PpmIO_read(FILE *fp, A2Methods_T methods);
+
+
+/**********PpmIO_read_compact********
+ *
+ * Reads a portable pixmap into a new A2 array of the narrowest pixel
+ * format that holds its samples
+ * Inputs: an open file (or stdin), the methods suite, and whether to use
+ *      the padded formats
+ * Return: a Pnm_ppm whose pixels are PPMIO_RGB8 (PPMIO_RGBX8 if padded)
+ *      when the denominator is at most 255, else PPMIO_RGB16
+ *      (PPMIO_RGBX16). Input that isn't P6 goes to Pnm_ppmread, so its
+ *      pixels are struct Pnm_rgb
+ * Expects: fp and methods to be nonnull
+ * Notes:
+ *      Otherwise just like PpmIO_read. A PPMIO_RGB8 row is a straight
+ *      copy of the file's bytes. The array's element size tells later
+ *      users which format they have
+ *
+ ************************/
+Pnm_ppm PpmIO_read_compact(FILE *fp, A2Methods_T methods, bool padded);
+
+
+/**********PpmIO_read_reusing********
+ *
+ * PpmIO_read or PpmIO_read_compact, into an array left over from an
+ * earlier image when it has the right shape
+ * Inputs: an open file, the methods suite, PPMIO_PNM_RGB to read like
+ *      PpmIO_read or 0 to read like PpmIO_read_compact, whether to use
+ *      the padded formats, and where a spare array is kept
+ * Return: the image, to be freed with Pnm_ppmfree or, to keep its array,
+ *      FREE
+ * Expects: spare to be nonnull; *spare may be NULL
+ * Notes:
+ *      If *spare has the image's width, height and element size, the
+ *      pixels are decoded into it instead of a new array, and *spare
+ *      becomes NULL. Otherwise *spare is left alone. Every element is
+ *      overwritten, so what it held before doesn't matter
+ *
+ ************************/
+Pnm_ppm PpmIO_read_reusing(FILE *fp, A2Methods_T methods, int size,
+                           bool padded, A2Methods_UArray2 *spare);
+
+
+
+/*
+ * An image kept as planes: its red, green and blue samples each in their
+ * own array, all of the same shape and methods suite. Samples are one
+ * byte (unsigned char) if the denominator is at most 255, and two
+ * (uint16_t) otherwise
+ */
+typedef struct PpmIO_planar {
+        unsigned width, height, denominator;
+        A2Methods_UArray2 planes[3];            /* red, green, blue */
+        const struct A2Methods_T *methods;
+} *PpmIO_planar;
+
+
+/**********PpmIO_read_planar********
+ *
+ * Reads a portable pixmap into three new A2 arrays, one per channel
+ * Inputs: an open file (or stdin), and the methods suite the planes
+ *      should be stored with
+ * Return: the image, to be freed with PpmIO_planar_free
+ * Expects: fp and methods to be nonnull
+ * Notes:
+ *      P6 input is read like PpmIO_read does, except that each row is
+ *      split into channels, a contiguous run of each plane's row (a
+ *      whole row, or the part of it in one block) at a time. Anything
+ *      else is read with Pnm_ppmread and split a pixel at a time
+ *
+ ************************/
+PpmIO_planar PpmIO_read_planar(FILE *fp, A2Methods_T methods);
+
+
+/**********PpmIO_write_planar********
+ *
+ * Writes a planar image to fp as a raw (P6) portable pixmap
+ * Inputs: an open file (or stdout) and the image
+ * Return: nothing
+ * Expects: fp and image to be nonnull, and image to be at least 1 x 1
+ * Notes:
+ *      About a megabyte of rows at a time are interleaved back into
+ *      samples from each plane's contiguous runs, then written with one
+ *      fwrite
+ *
+ ************************/
+void PpmIO_write_planar(FILE *fp, PpmIO_planar image);
+
+
+/**********PpmIO_planar_free********
+ *
+ * Frees a planar image and its planes
+ * Inputs: pointer to the image
+ * Return: nothing, and *image is set to NULL
+ * Expects: image and *image to be nonnull
+ *
+ ************************/
+void PpmIO_planar_free(PpmIO_planar *image);
+
+
+/**********PpmIO_check********
+ *
+ * Says whether a file holds a whole raw (P6) portable pixmap, without
+ * reading its pixels
+ * Inputs: an open file
+ * Return: true if fp is a regular file that starts with a well formed P6
+ *      header and is long enough for every pixel the header promises
+ * Expects: fp to be nonnull
+ * Notes:
+ *      Never raises, so it can vet files on threads that mustn't (CII's
+ *      exceptions aren't thread safe). Leaves fp rewound
+ *
+ ************************/
+bool PpmIO_check(FILE *fp);
+
+
+/**********PpmIO_read_header********
+ *
+ * Reads the header of a raw (P6) portable pixmap
+ * Inputs: an open file (or stdin), and where to put the width, height
+ *      and maxval (denominator)
+ * Return: true if the image is P6, false if it isn't, in which case
+ *      nothing has been consumed
+ * Expects: all arguments to be nonnull
+ * Notes:
+ *      Leaves fp at the first pixel byte. Raises Pnm_Badformat if the
+ *      header is malformed
+ *
+ ************************/
+bool PpmIO_read_header(FILE *fp, int *width, int *height, int *maxval);
+
+/**********PpmIO_write********
+ *
+ * Writes a pixmap to fp as a raw (P6) portable pixmap
+ * Inputs: an open file (or stdout) and the pixmap
+ * Return: nothing
+ * Expects: fp and pixmap to be nonnull, the pixmap to be at least 1 x 1,
+ *      its denominator to be at most 65535 (255 for the 8 bit formats),
+ *      and its pixels to be struct Pnm_rgb or one of the formats above
+ * Notes:
+ *      Writes the same bytes Pnm_ppmwrite does. Rows are encoded into a
+ *      cache line aligned buffer of about a megabyte, which goes out in
+ *      one fwrite when it fills. A UArray2b is encoded one band of blocks
+ *      at a time, each block read straight through in the order it is
+ *      stored, so the buffer holds exactly one band of rows
+ *
+ ************************/
+void PpmIO_write(FILE *fp, Pnm_ppm pixmap);
+
+
+/**********PpmIO_stream********
+ *
+ * Copies a P6 image from in to out with a row-order preserving
+ * transform applied, without ever holding the whole image
+ * Inputs: input and output files, and the rotation as ppmtrans encodes
+ *      it: only 0, 180, 360 (flip horizontal) and 450 (flip vertical)
+ * Return: true if the image was copied, false if nothing was read
+ *      because this can't be streamed: another rotation, input that
+ *      isn't P6, or a 180 or vertical flip of input that isn't a
+ *      regular file
+ * Expects: in and out to be nonnull
+ * Notes:
+ *      Pixels are never decoded, only moved as 3 or 6 byte groups, so
+ *      the samples and denominator come out exactly as they went in.
+ *      0 and the horizontal flip work on a megabyte or so of rows at a
+ *      time. 180 and the vertical flip need the rows bottom up, which
+ *      they get by pread()ing the same size bands from the end of the
+ *      file backwards. Raises Pnm_Badformat like PpmIO_read
+ *
+ ************************/
+bool PpmIO_stream(FILE *in, FILE *out, int rotation);
+
+#endif
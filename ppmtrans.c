@@ -14,17 +14,38 @@
 #include <string.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
 
 #include "assert.h"
+#include "mem.h"
 #include "a2methods.h"
 #include "a2plain.h"
+#include "a2flat.h"
 #include "a2blocked.h"
+#include "a2morton.h"
 #include "pnm.h"
 #include "cputiming.h"
+#include "cacheinfo.h"
+#include "oblivious.h"
+#include "kernels.h"
+#include "threadpool.h"
+#include "parallel.h"
+#include "ppmio.h"
+#include "outofcore.h"
+#include "inplace.h"
+#include "dihedral.h"
+#include "region.h"
+#include "slab.h"
+
+/* how much of the destination -out-of-core keeps in memory */
+#define OUT_OF_CORE_BUDGET ((size_t)256 << 20)
 
 #define SET_METHODS(METHODS, MAP, WHAT) do {                    \
         methods = (METHODS);                                    \
         assert(methods != NULL);                                \
+        layout_given = true;                                    \
         map = methods->MAP;                                     \
         if (map == NULL) {                                      \
                 fprintf(stderr, "%s does not support "          \
@@ -34,8 +55,43 @@
         }                                                       \
 } while (false)
 
-void rotateimage(Pnm_ppm Image, int rotationDegree, A2Methods_T methods);
+void rotateimage(Pnm_ppm Image, int rotationDegree, A2Methods_T methods,
+                 A2Methods_mapfun *map, bool oblivious, Threadpool_T pool,
+                 bool inplace, const A2Methods_view *crop);
+
+void rotateplanar(PpmIO_planar Image, int rotationDegree, 
+                  A2Methods_T methods, A2Methods_mapfun *map, bool oblivious,
+                  Threadpool_T pool, bool inplace, 
+                  const A2Methods_view *crop);
+
+/* what every image of a -batch is done with */
+struct batch {
+        int rotation;
+        A2Methods_T methods;
+        A2Methods_mapfun *map;
+        bool oblivious;
+        bool inplace;
+        int size;               /* for PpmIO_read_reusing */
+        bool padded;
+        Region_T *regions;      /* one a worker with -arena, else NULL */
+        Threadpool_T pool;
+        size_t small;           /* files smaller than this run side by side */
+        struct batchitem *items;
+        int nitems;
+        struct spares *spares;  /* one pair of arrays a worker */
+};
+
+bool runbatch(struct batch *batch, const char *manifest, int nthreads,
+              bool pin, char *time_file_name, const char *arena);
 
+void reportregion(const char *time_file_name, struct Region_stats stats);
+
+void reportfaults(FILE *timingOutput, struct rusage *start, 
+                  struct rusage *stop);
+
+/* The apply functions take the source's dimensions from the destination
+   (newArray), since with -crop currArray is bigger than the part of it
+   being transformed */
 void applyrotation90(int col, int row, A2Methods_UArray2 currArray, void* curr,
 void* newArray );
 
@@ -57,29 +113,81 @@ void* newArray );
 void applytranspose(int col, int row, A2Methods_UArray2 currArray, void* curr, 
 void* newArray );
 
+void applytransverse(int col, int row, A2Methods_UArray2 currArray, void* curr,
+void* newArray );
+
 
 static void
 usage(const char *progname)
 {
         fprintf(stderr, "Usage: %s [-rotate <angle>] "
-                        "[-{row,col,block}-major] [filename]\n",
+                        "[-flip {horizontal,vertical}] [-transpose] "
+                        "[-transverse] "
+                        "[-{row,col,block,morton}-major] [-plain] "
+                        "[-tile-cache {L1,L2,LLC}] [-cache-oblivious] "
+                        "[-threads <n>] [-pin] [-out-of-core] "
+                        "[-in-place] [-pixel-format {rgb,rgbx,pnm}] "
+                        "[-planar] [-batch <manifest>] "
+                        "[-arena {pages,thp,hugetlb}] "
+                        "[-huge-pages {thp,hugetlb}] [-prefault] "
+                        "[-crop <w>x<h>+<x>+<y>] [filename]\n",
                         progname);
         exit(1);
 }
 
+static Region_pages regionpages(const char *arena)
+{
+        if (strcmp(arena, "thp") == 0) {
+                return REGION_THP;
+        } else if (strcmp(arena, "hugetlb") == 0) {
+                return REGION_HUGETLB;
+        }
+        return REGION_PAGES;
+}
+
+/* a -crop rectangle has to lie inside the image */
+static void checkcrop(const A2Methods_view *crop, unsigned width,
+                      unsigned height)
+{
+        if (crop != NULL && 
+            ((long)crop->x + crop->width > (long)width ||
+             (long)crop->y + crop->height > (long)height)) {
+                fprintf(stderr, "ppmtrans: crop %dx%d+%d+%d is outside the "
+                                "%ux%u image\n", crop->width, crop->height,
+                                crop->x, crop->y, width, height);
+                exit(EXIT_FAILURE);
+        }
+}
+
 int main(int argc, char *argv[]) 
 {
         Except_T cantopen = {"Can't open file\n"};
         char *time_file_name = NULL;
-        int   rotation       = 0;
+        int   rotation       = DIHEDRAL_IDENTITY;
         int   i;
         FILE *fp = NULL;
         char *flip;
         bool isfile = false;
         bool timerOn = false;
+        bool oblivious = false;
+        bool layout_given = false;
+        bool plain = false;
+        int nthreads = 1;
+        bool pin = false;
+        bool outofcore = false;
+        bool inplace = false;
+        char *format = "rgb";
+        A2Methods_view cropview;
+        A2Methods_view *crop = NULL;
+        bool planar = false;
+        char *manifest = NULL;
+        char *arena = NULL;
+        Region_T region = NULL;
+        bool prefault = false;
+        Threadpool_T pool = NULL;
 
-        /* default to UArray2 methods */
-        A2Methods_T methods = uarray2_methods_plain; 
+        /* default to the single-slab UArray2f methods */
+        A2Methods_T methods = uarray2_methods_flat; 
         assert(methods);
 
         /* default to best map */
@@ -88,22 +196,28 @@ int main(int argc, char *argv[])
 
         for (i = 1; i < argc; i++) {
                 if (strcmp(argv[i], "-row-major") == 0) {
-                        SET_METHODS(uarray2_methods_plain, map_row_major, 
+                        SET_METHODS(uarray2_methods_flat, map_row_major, 
                                     "row-major");
                 } else if (strcmp(argv[i], "-col-major") == 0) {
-                        SET_METHODS(uarray2_methods_plain, map_col_major, 
+                        SET_METHODS(uarray2_methods_flat, map_col_major, 
                                     "column-major");
+                } else if (strcmp(argv[i], "-plain") == 0) {
+                        plain = true;
+                        layout_given = true;
                 } else if (strcmp(argv[i], "-block-major") == 0) {
                         SET_METHODS(uarray2_methods_blocked, map_block_major,
                                     "block-major");
+                } else if (strcmp(argv[i], "-morton-major") == 0) {
+                        SET_METHODS(uarray2_methods_morton, map_default,
+                                    "morton-major");
                 } else if (strcmp(argv[i], "-rotate") == 0) {
                         if (!(i + 1 < argc)) {      /* no rotate value */
                                 usage(argv[0]);
                         }
                         char *endptr;
-                        rotation = strtol(argv[++i], &endptr, 10);
-                        if (!(rotation == 0 || rotation == 90 ||
-                            rotation == 180 || rotation == 270)) {
+                        int angle = strtol(argv[++i], &endptr, 10);
+                        if (!(angle == 0 || angle == 90 ||
+                            angle == 180 || angle == 270)) {
                                 fprintf(stderr, 
                                         "Rotation must be 0, 90 180 or 270\n");
                                 usage(argv[0]);
@@ -111,6 +225,104 @@ int main(int argc, char *argv[])
                         if (!(*endptr == '\0')) {    /* Not a number */
                                 usage(argv[0]);
                         }
+                        rotation = Dihedral_compose(rotation, angle);
+                } else if (strcmp(argv[i], "-tile-cache") == 0) {
+                        if (!(i + 1 < argc)) {      /* no cache level */
+                                usage(argv[0]);
+                        }
+                        char *level = argv[++i];
+                        if (strcmp(level, "L1") == 0) {
+                                CacheInfo_set_default_level(1);
+                        } else if (strcmp(level, "L2") == 0) {
+                                CacheInfo_set_default_level(2);
+                        } else if (strcmp(level, "LLC") == 0) {
+                                CacheInfo_set_default_level(3);
+                        } else {
+                                fprintf(stderr, 
+                                        "Tile cache must be L1, L2 or LLC\n");
+                                usage(argv[0]);
+                        }
+                } else if (strcmp(argv[i], "-cache-oblivious") == 0) {
+                        oblivious = true;
+                } else if (strcmp(argv[i], "-threads") == 0) {
+                        if (!(i + 1 < argc)) {      /* no thread count */
+                                usage(argv[0]);
+                        }
+                        char *endptr;
+                        nthreads = strtol(argv[++i], &endptr, 10);
+                        if (*endptr != '\0' || nthreads < 0) {
+                                fprintf(stderr, "Threads must be a count, "
+                                                "or 0 for one per CPU\n");
+                                usage(argv[0]);
+                        }
+                } else if (strcmp(argv[i], "-pin") == 0) {
+                        pin = true;
+                } else if (strcmp(argv[i], "-out-of-core") == 0) {
+                        outofcore = true;
+                } else if (strcmp(argv[i], "-in-place") == 0) {
+                        inplace = true;
+                } else if (strcmp(argv[i], "-planar") == 0) {
+                        planar = true;
+                        layout_given = true;
+                } else if (strcmp(argv[i], "-batch") == 0) {
+                        if (!(i + 1 < argc)) {      /* no manifest */
+                                usage(argv[0]);
+                        }
+                        manifest = argv[++i];
+                } else if (strcmp(argv[i], "-arena") == 0) {
+                        if (!(i + 1 < argc)) {      /* no page kind */
+                                usage(argv[0]);
+                        }
+                        arena = argv[++i];
+                        if (!(strcmp(arena, "pages") == 0 ||
+                              strcmp(arena, "thp") == 0 ||
+                              strcmp(arena, "hugetlb") == 0)) {
+                                fprintf(stderr, "Arena must be pages, thp "
+                                                "or hugetlb\n");
+                                usage(argv[0]);
+                        }
+                } else if (strcmp(argv[i], "-huge-pages") == 0) {
+                        if (!(i + 1 < argc)) {      /* no page kind */
+                                usage(argv[0]);
+                        }
+                        char *kind = argv[++i];
+                        if (!(strcmp(kind, "thp") == 0 ||
+                              strcmp(kind, "hugetlb") == 0)) {
+                                fprintf(stderr, "Huge pages must be thp "
+                                                "or hugetlb\n");
+                                usage(argv[0]);
+                        }
+                        Slab_pages(regionpages(kind));
+                } else if (strcmp(argv[i], "-prefault") == 0) {
+                        prefault = true;
+                } else if (strcmp(argv[i], "-crop") == 0) {
+                        if (!(i + 1 < argc)) {      /* no rectangle */
+                                usage(argv[0]);
+                        }
+                        char extra;
+                        cropview.parent = NULL;
+                        if (sscanf(argv[++i], "%dx%d+%d+%d%c", 
+                                   &cropview.width, &cropview.height,
+                                   &cropview.x, &cropview.y, &extra) != 4 ||
+                            cropview.width <= 0 || cropview.height <= 0 ||
+                            cropview.x < 0 || cropview.y < 0) {
+                                fprintf(stderr, "Crop must be "
+                                                "<width>x<height>+<x>+<y>\n");
+                                usage(argv[0]);
+                        }
+                        crop = &cropview;
+                } else if (strcmp(argv[i], "-pixel-format") == 0) {
+                        if (!(i + 1 < argc)) {      /* no format */
+                                usage(argv[0]);
+                        }
+                        format = argv[++i];
+                        if (!(strcmp(format, "rgb") == 0 ||
+                              strcmp(format, "rgbx") == 0 ||
+                              strcmp(format, "pnm") == 0)) {
+                                fprintf(stderr, "Pixel format must be rgb, "
+                                                "rgbx or pnm\n");
+                                usage(argv[0]);
+                        }
                 } else if (strcmp(argv[i], "-time") == 0) {
                         time_file_name = argv[++i];
                         timerOn = true;
@@ -123,12 +335,18 @@ int main(int argc, char *argv[])
                                 usage(argv[0]);
                         }
                         if (strcmp(flip, "horizontal") == 0) {
-                                rotation = 360;
+                                rotation = Dihedral_compose(rotation,
+                                                DIHEDRAL_FLIP_HORIZONTAL);
                         } else {
-                                rotation = 450;
+                                rotation = Dihedral_compose(rotation,
+                                                DIHEDRAL_FLIP_VERTICAL);
                         }
                 } else if (strcmp(argv[i], "-transpose") == 0) {
-                        rotation = 540;
+                        rotation = Dihedral_compose(rotation, 
+                                                    DIHEDRAL_TRANSPOSE);
+                } else if (strcmp(argv[i], "-transverse") == 0) {
+                        rotation = Dihedral_compose(rotation, 
+                                                    DIHEDRAL_TRANSVERSE);
                 } else if (*argv[i] == '-') {
                         fprintf(stderr, "%s: unknown option '%s'\n", argv[0],
                                 argv[i]);
@@ -141,6 +359,49 @@ int main(int argc, char *argv[])
                         isfile = true;
                 }
         }
+
+        /* -plain swaps the flat suite for the original UArray2 one, with
+           the same map */
+        if (plain) {
+                if (methods != uarray2_methods_flat) {
+                        fprintf(stderr, "-plain only goes with -row-major "
+                                        "or -col-major\n");
+                        usage(argv[0]);
+                }
+                map = map == methods->map_col_major 
+                        ? uarray2_methods_plain->map_col_major
+                        : uarray2_methods_plain->map_default;
+                methods = uarray2_methods_plain;
+        }
+
+        if (crop != NULL && (manifest != NULL || outofcore)) {
+                fprintf(stderr, "-crop can't be used with -batch or "
+                                "-out-of-core\n");
+                usage(argv[0]);
+        }
+
+        /* every image named in the manifest, in one process */
+        if (manifest != NULL) {
+                if (isfile || planar || outofcore) {
+                        fprintf(stderr, "-batch takes no filename, "
+                                        "-planar or -out-of-core\n");
+                        usage(argv[0]);
+                }
+                struct batch batch;
+                batch.rotation = rotation;
+                batch.methods = methods;
+                batch.map = map;
+                batch.oblivious = oblivious;
+                batch.inplace = inplace;
+                batch.size = strcmp(format, "pnm") == 0 ? PPMIO_PNM_RGB : 0;
+                batch.padded = strcmp(format, "rgbx") == 0;
+                /* images are read inside the pool's tasks, so they
+                   can't hand their pages back to it */
+                Slab_prefault(prefault, NULL);
+                exit(runbatch(&batch, manifest, nthreads, pin, 
+                              time_file_name, arena) ? EXIT_SUCCESS 
+                                                     : EXIT_FAILURE);
+        }
         if (!isfile) {
                 fp = stdin;
         } 
@@ -149,23 +410,94 @@ int main(int argc, char *argv[])
                 RAISE(cantopen);
         }
 
-        Pnm_ppm pixmap = Pnm_ppmread(fp, methods); 
-        assert(pixmap != NULL);
+        /* the transforms given came to nothing, so unless it is being
+           timed the image is copied straight through, whatever the
+           layout or engine */
+        if (rotation == DIHEDRAL_IDENTITY && !timerOn && crop == NULL &&
+            PpmIO_stream(fp, stdout, rotation)) {
+                fclose(fp);
+                exit(EXIT_SUCCESS);
+        }
+
+        /* images bigger than memory go through a scratch file; anything
+           but P6 can't be that big, and is read the usual way */
+        if (outofcore && OutOfCore_transform(fp, stdout, rotation,
+                                             OUT_OF_CORE_BUDGET)) {
+                fclose(fp);
+                exit(EXIT_SUCCESS);
+        }
+
+        /* 0, 180 and the flips keep the rows in order, or just reverse
+           it, so unless a layout or engine was asked for (or the rotation
+           is being timed) they stream through without the whole image */
+        if (!layout_given && !oblivious && nthreads == 1 && !timerOn &&
+            crop == NULL && PpmIO_stream(fp, stdout, rotation)) {
+                fclose(fp);
+                exit(EXIT_SUCCESS);
+        }
+
+        if (nthreads != 1) {
+                pool = Threadpool_new(nthreads, pin);
+        }
+        Slab_prefault(prefault, pool);
+
+        /* with -arena, every slab (both images' pixels, and the I/O
+           buffers) comes out of a few big mappings */
+        if (arena != NULL) {
+                region = Region_new(0, regionpages(arena));
+                Slab_use(region);
+        }
+
+        /* 3 (or 6) bytes a pixel unless asked for padded pixels, or the
+           12 byte struct Pnm_rgb, or one plane per channel */
+        Pnm_ppm pixmap = NULL;
+        PpmIO_planar planes = NULL;
+        unsigned npixels;
+        if (planar) {
+                planes = PpmIO_read_planar(fp, methods);
+        } else if (strcmp(format, "pnm") == 0) {
+                pixmap = PpmIO_read(fp, methods);
+        } else {
+                pixmap = PpmIO_read_compact(fp, methods, 
+                                            strcmp(format, "rgbx") == 0);
+        }
+        if (planes != NULL) {
+                npixels = planes->width * planes->height;
+                checkcrop(crop, planes->width, planes->height);
+        } else {
+                assert(pixmap != NULL);
+                npixels = pixmap->width * pixmap->height;
+                checkcrop(crop, pixmap->width, pixmap->height);
+        }
+        if (crop != NULL) {
+                npixels = crop->width * crop->height;
+        }
 
         /*If a timer file is included, record time for rotation,
                 otherwise just do the rotate*/
         if (timerOn) {
                 double time_used;
                 CPUTime_T timer;
+                struct timespec wall_start, wall_stop;
                 
+                struct rusage usage_start, usage_stop;
                 timer = CPUTime_New();
+                getrusage(RUSAGE_SELF, &usage_start);
+                clock_gettime(CLOCK_MONOTONIC, &wall_start);
                 CPUTime_Start(timer);
                 
-                rotateimage(pixmap, rotation, methods);
+                if (planes != NULL) {
+                        rotateplanar(planes, rotation, methods, map, 
+                                     oblivious, pool, inplace, crop);
+                } else {
+                        rotateimage(pixmap, rotation, methods, map, 
+                                    oblivious, pool, inplace, crop);
+                }
 
                 time_used = CPUTime_Stop(timer);
-                int pixelsperns = (time_used/((pixmap->width) * 
-                                                (pixmap->height)));
+                clock_gettime(CLOCK_MONOTONIC, &wall_stop);
+                getrusage(RUSAGE_SELF, &usage_stop);
+                int pixelsperns = (time_used / npixels);
                 FILE *timingOutput = NULL;
                 timingOutput = fopen(time_file_name, "a");
 
@@ -175,22 +507,130 @@ int main(int argc, char *argv[])
                         fprintf(timingOutput,
                                 "Total Time: %0.f ns, Time/Pixel: %d ns\n", 
                                 time_used, pixelsperns);
+                        /* CPU time adds up every thread, so with more
+                           than one the elapsed time is what shows the
+                           speedup */
+                        if (pool != NULL) {
+                                double wall = 
+                                        (wall_stop.tv_sec - 
+                                         wall_start.tv_sec) * 1e9 +
+                                        (wall_stop.tv_nsec - 
+                                         wall_start.tv_nsec);
+                                fprintf(timingOutput, "Wall Time: %0.f ns, "
+                                        "Threads: %d\n", wall,
+                                        Threadpool_size(pool));
+                        }
+                        reportfaults(timingOutput, &usage_start, 
+                                     &usage_stop);
                         CPUTime_Free(&timer);
                         fclose(timingOutput);
 
                 }
+        } else if (planes != NULL) {
+                rotateplanar(planes, rotation, methods, map, oblivious, pool,
+                             inplace, crop);
+        } else {
+                rotateimage(pixmap, rotation, methods, map, oblivious, pool,
+                            inplace, crop);
+        }
+        if (pool != NULL) {
+                Slab_prefault(false, NULL);
+                Threadpool_free(&pool);
+        }
+        if (planes != NULL) {
+                PpmIO_planar_free(&planes);
         } else {
-                rotateimage(pixmap, rotation, methods);
+                Pnm_ppmfree(&pixmap);
+        }
+        if (region != NULL) {
+                Slab_use(NULL);
+                if (timerOn) {
+                        reportregion(time_file_name, Region_stats(region));
+                }
+                Region_free(&region);
         }
-        Pnm_ppmfree(&pixmap);
         fclose(fp);
         exit(EXIT_SUCCESS);
 }
 
+/**********applyfor********
+ *
+ * Picks the apply function for a rotation
+ * Inputs: rotationDegree, and where to say whether it swaps the axes
+ * Return: the apply function
+ * 
+ * Notes:
+ *      Axes are swapped for 90, 270, transpose and transverse
+ ************************/
+static A2Methods_applyfun *applyfor(int rotationDegree, bool *swapaxes)
+{
+        *swapaxes = Dihedral_swapsaxes(rotationDegree);
+        switch (rotationDegree) {
+        case 0:   return applyrotation0;
+        case 90:  return applyrotation90;
+        case 180: return applyrotation180;
+        case 270: return applyrotation270;
+        case 360: return applyhorizontal;
+        case 450: return applyvertical;
+        case 540: return applytranspose;
+        case 630: return applytransverse;
+        }
+        assert(0);
+        return NULL;
+}
+
+/**********transform********
+ *
+ * Fills a destination image from a view of the source array
+ * Inputs: the view (the whole array, or a -crop of it), the destination
+ *      Pnm_ppm (its methods, size and pixels already set), int
+ *      rotationDegree, its apply function, A2Methods_mapfun *map, bool
+ *      oblivious, Threadpool_T pool
+ * Return: none
+ * 
+ * Notes:
+ *      If oblivious is set the cache-oblivious engine does the work.
+ *      Otherwise, when map is the suite's default map, a pool (if there
+ *      is one) splits the image across its threads, or else a kernel
+ *      loop does it if the kernels know the suite. Anything else maps
+ *      an apply function over the image with map, on this thread.
+ *      A view smaller than its array is done by the kernels or the
+ *      suite's map_region, on this thread, reading only its pixels
+ ************************/
+static void transform(A2Methods_view src, Pnm_ppm dest, 
+                      int rotationDegree, A2Methods_applyfun *apply,
+                      A2Methods_mapfun *map, bool oblivious, 
+                      Threadpool_T pool)
+{
+        A2Methods_T methods = dest->methods;
+        A2Methods_UArray2 initial = src.parent;
+        if (src.width < methods->width(initial) || 
+            src.height < methods->height(initial)) {
+                assert(methods->map_region != NULL);
+                if (map != methods->map_default ||
+                    !Kernels_transform_view(methods, src, dest->pixels,
+                                            rotationDegree)) {
+                        methods->map_region(src, apply, dest);
+                }
+        } else if (oblivious) {
+                Oblivious_transform(methods, initial, dest->pixels,
+                                    rotationDegree);
+        } else if (pool != NULL && map == methods->map_default) {
+                Parallel_transform(pool, methods, initial, dest->pixels,
+                                   rotationDegree, apply, dest);
+        } else if (map != methods->map_default ||
+                   !Kernels_transform(methods, initial, dest->pixels,
+                                      rotationDegree)) {
+                map(initial, apply, dest);
+        }
+}
+
 /**********rotateimage********
  *
  * function that calls different apply functions based on rotation
- * Inputs: Pnm_ppm Image, int rotationDegree, A2Methods_T methods
+ * Inputs: Pnm_ppm Image, int rotationDegree, A2Methods_T methods,
+ *      A2Methods_mapfun *map, bool oblivious, Threadpool_T pool,
+ *      bool inplace, and the -crop rectangle (or NULL)
  * Return: none
  * 
  * Expects:
@@ -201,71 +641,443 @@ int main(int argc, char *argv[])
  *      rotation = 360 is flip horizontal
  *      rotation = 450 is flip vertical
  *      rotation = 540 is transpose
+ *      rotation = 630 is transverse
+ *      transform picks the engine that does the work.
+ *      With inplace set, Image itself is transformed and printed, and
+ *      no second image is made, unless Inplace can't do it (90, 270,
+ *      transpose or transverse of a non-square array that isn't a
+ *      UArray2f). With a crop, just that rectangle of Image is
+ *      transformed, straight from Image, and never in place
  ************************/
-void rotateimage(Pnm_ppm Image, int rotationDegree, A2Methods_T methods)
+void rotateimage(Pnm_ppm Image, int rotationDegree, A2Methods_T methods,
+                 A2Methods_mapfun *map, bool oblivious, Threadpool_T pool,
+                 bool inplace, const A2Methods_view *crop)
 {
         assert(Image != NULL);
         assert(methods != NULL);
-        unsigned width = Image->width;
-        unsigned height = Image->height;
-
         A2Methods_UArray2 initial = Image->pixels;
+        A2Methods_view src = { initial, 0, 0, Image->width, Image->height };
+        if (crop != NULL) {
+                src = *crop;
+                src.parent = initial;
+        }
+        unsigned width = src.width;
+        unsigned height = src.height;
+
+        if (crop == NULL && inplace && 
+            Inplace_handles(methods, initial, rotationDegree)) {
+                Inplace_transform(methods, initial, rotationDegree);
+                Image->width = methods->width(initial);
+                Image->height = methods->height(initial);
+                PpmIO_write(stdout, Image);
+                return;
+        }
 
         Pnm_ppm newPpm = malloc(sizeof(struct Pnm_ppm));
         assert(newPpm != NULL);
 
         newPpm->methods = methods;
         newPpm->denominator = Image->denominator;
-        
-        /*Axes are swapped for 90, 270, transpose, same as original otherwise*/
-        if (rotationDegree == 90) {
-                newPpm->width = height;
-                newPpm->height = width;
-                newPpm->pixels = methods->new(height, width, 
-                                                sizeof(struct Pnm_rgb));
-                methods->map_default(initial, applyrotation90, newPpm);
-        } else if (rotationDegree == 180) {
-                newPpm->width = width;
-                newPpm->height = height;
-                newPpm->pixels = methods->new(width, height, 
-                                                sizeof(struct Pnm_rgb));
-                methods->map_default(initial, applyrotation180, newPpm);
-        } else if (rotationDegree == 0) {
-                newPpm->width = width;
-                newPpm->height = height;
-                newPpm->pixels = methods->new(width, height, 
-                                                sizeof(struct Pnm_rgb));
-                methods->map_default(initial, applyrotation0, newPpm);
-        } else if (rotationDegree == 270) {
-                newPpm->width = height;
-                newPpm->height = width;
-                newPpm->pixels = methods->new(height, width, 
-                                                sizeof(struct Pnm_rgb));
-                methods->map_default(initial, applyrotation270, newPpm);
-        } else if (rotationDegree == 360) {
-                newPpm->width = width;
-                newPpm->height = height;
-                newPpm->pixels = methods->new(width, height, 
-                                                sizeof(struct Pnm_rgb));
-                methods->map_default(initial, applyhorizontal, newPpm);
-        } else if (rotationDegree == 450) {
-                newPpm->width = width;
-                newPpm->height = height;
-                newPpm->pixels = methods->new(width, height, 
-                                                sizeof(struct Pnm_rgb));
-                methods->map_default(initial, applyvertical, newPpm);
-        } else if (rotationDegree == 540) {
-                newPpm->width = height;
-                newPpm->height = width;
-                newPpm->pixels = methods->new(height, width, 
-                                                sizeof(struct Pnm_rgb));
-                methods->map_default(initial, applytranspose, newPpm);
-        }
-        
-        Pnm_ppmwrite(stdout, newPpm);
+
+        bool swapaxes;
+        A2Methods_applyfun *apply = applyfor(rotationDegree, &swapaxes);
+
+        newPpm->width = swapaxes ? height : width;
+        newPpm->height = swapaxes ? width : height;
+        newPpm->pixels = methods->new(newPpm->width, newPpm->height,
+                                      methods->size(initial));
+        transform(src, newPpm, rotationDegree, apply, map, oblivious, pool);
+
+        PpmIO_write(stdout, newPpm);
         Pnm_ppmfree(&newPpm);
 }
 
+/**********rotateplanar********
+ *
+ * rotateimage for an image kept as one plane per channel
+ * Inputs: PpmIO_planar Image, and the rest as for rotateimage
+ * Return: none
+ * 
+ * Notes:
+ *      Each plane is transformed on its own, by the same engines, into a
+ *      new plane that replaces it before the next one is done, so only
+ *      one extra plane is ever allocated. With inplace set, planes that
+ *      Inplace can do are done in place. With a crop, each plane is
+ *      cut as it is transformed. Prints the image when done
+ ************************/
+void rotateplanar(PpmIO_planar Image, int rotationDegree, 
+                  A2Methods_T methods, A2Methods_mapfun *map, bool oblivious,
+                  Threadpool_T pool, bool inplace, 
+                  const A2Methods_view *crop)
+{
+        assert(Image != NULL);
+        assert(methods != NULL);
+        bool swapaxes;
+        A2Methods_applyfun *apply = applyfor(rotationDegree, &swapaxes);
+        A2Methods_view src = { NULL, 0, 0, Image->width, Image->height };
+        if (crop != NULL) {
+                src = *crop;
+        }
+        unsigned width = swapaxes ? src.height : src.width;
+        unsigned height = swapaxes ? src.width : src.height;
+
+        for (int c = 0; c < 3; c++) {
+                A2Methods_UArray2 initial = Image->planes[c];
+                src.parent = initial;
+                if (crop == NULL && inplace && 
+                    Inplace_handles(methods, initial, rotationDegree)) {
+                        Inplace_transform(methods, initial, rotationDegree);
+                        continue;
+                }
+                struct Pnm_ppm plane;
+                plane.width = width;
+                plane.height = height;
+                plane.denominator = Image->denominator;
+                plane.methods = methods;
+                plane.pixels = methods->new(width, height, 
+                                            methods->size(initial));
+                transform(src, &plane, rotationDegree, apply, map,
+                          oblivious, pool);
+                methods->free(&Image->planes[c]);
+                Image->planes[c] = plane.pixels;
+        }
+        Image->width = width;
+        Image->height = height;
+        PpmIO_write_planar(stdout, Image);
+}
+
+/* one line of a -batch manifest */
+struct batchitem {
+        char *in;
+        char *out;
+        bool deferred;          /* left for after the side by side ones */
+        bool failed;
+};
+
+/* the arrays a worker's last image left behind, for its next one */
+struct spares {
+        A2Methods_UArray2 src;
+        A2Methods_UArray2 dst;
+};
+
+/* the array for a w x h image of size byte elements, from *spare if it
+   is that shape, else new (and *spare freed) */
+static A2Methods_UArray2 reuse(A2Methods_T methods, A2Methods_UArray2 *spare,
+                               int w, int h, int size)
+{
+        A2Methods_UArray2 array = *spare;
+        *spare = NULL;
+        if (array != NULL && methods->width(array) == w &&
+            methods->height(array) == h && methods->size(array) == size) {
+                return array;
+        }
+        if (array != NULL) {
+                methods->free(&array);
+        }
+        return methods->new(w, h, size);
+}
+
+/*
+ * can in go side by side with other images: a small regular file holding
+ * a whole P6 image? Anything else, malformed input included, is left for
+ * the main thread, which alone may raise (CII's exceptions aren't thread
+ * safe)
+ */
+static bool small_enough(struct batch *batch, FILE *in)
+{
+        struct stat st;
+        if (fstat(fileno(in), &st) != 0 || !S_ISREG(st.st_mode) ||
+            (size_t)st.st_size >= batch->small) {
+                return false;
+        }
+        return PpmIO_check(in);
+}
+
+/* reads, transforms and writes one image of a batch */
+static void batchconvert(struct batch *batch, FILE *in, FILE *out,
+                         struct spares *spares, Region_T region, 
+                         bool concurrent)
+{
+        A2Methods_T methods = batch->methods;
+        if (batch->rotation == DIHEDRAL_IDENTITY && 
+            PpmIO_stream(in, out, batch->rotation)) {
+                return;
+        }
+
+        /* a region gives back the same memory each image instead, once
+           it is reset, so the arrays aren't kept */
+        struct spares none = { NULL, NULL };
+        if (region != NULL) {
+                Slab_use(region);
+                spares = &none;
+        }
+        Pnm_ppm pixmap = PpmIO_read_reusing(in, methods, batch->size,
+                                            batch->padded, &spares->src);
+        A2Methods_UArray2 initial = pixmap->pixels;
+        if (batch->inplace &&
+            Inplace_handles(methods, initial, batch->rotation)) {
+                Inplace_transform(methods, initial, batch->rotation);
+                pixmap->width = methods->width(initial);
+                pixmap->height = methods->height(initial);
+                PpmIO_write(out, pixmap);
+        } else {
+                bool swapaxes;
+                A2Methods_applyfun *apply = applyfor(batch->rotation, 
+                                                     &swapaxes);
+                struct Pnm_ppm dest;
+                dest.width = swapaxes ? pixmap->height : pixmap->width;
+                dest.height = swapaxes ? pixmap->width : pixmap->height;
+                dest.denominator = pixmap->denominator;
+                dest.methods = methods;
+                dest.pixels = reuse(methods, &spares->dst, dest.width,
+                                    dest.height, methods->size(initial));
+                A2Methods_view whole = { initial, 0, 0, pixmap->width,
+                                         pixmap->height };
+                transform(whole, &dest, batch->rotation, apply, 
+                          batch->map, batch->oblivious, 
+                          concurrent ? NULL : batch->pool);
+                PpmIO_write(out, &dest);
+                spares->dst = dest.pixels;
+        }
+
+        /* keep the source array, unless the spare wasn't its shape */
+        if (spares->src != NULL) {
+                methods->free(&spares->src);
+        }
+        spares->src = initial;
+        FREE(pixmap);
+        if (region != NULL) {
+                methods->free(&none.src);
+                if (none.dst != NULL) {
+                        methods->free(&none.dst);
+                }
+                Slab_use(NULL);
+                Region_reset(region);
+        }
+}
+
+/*
+ * Does one image of a batch with worker's spare arrays. When concurrent,
+ * images that can't run beside others are marked deferred and left alone.
+ * Input that turns out to be malformed fails its item, not the batch
+ */
+static void batchimage(struct batch *batch, struct batchitem *item, 
+                       int worker, bool concurrent)
+{
+        struct spares *spares = &batch->spares[worker];
+        Region_T region = batch->regions != NULL ? batch->regions[worker]
+                                                 : NULL;
+        FILE *in = fopen(item->in, "r");
+        if (in == NULL) {
+                fprintf(stderr, "ppmtrans: can't open %s\n", item->in);
+                item->failed = true;
+                return;
+        }
+        if (concurrent && !small_enough(batch, in)) {
+                item->deferred = true;
+                fclose(in);
+                return;
+        }
+        FILE *out = fopen(item->out, "w");
+        if (out == NULL) {
+                fprintf(stderr, "ppmtrans: can't write %s\n", item->out);
+                item->failed = true;
+                fclose(in);
+                return;
+        }
+
+        /* small_enough vetted the concurrent ones, so only the main
+           thread can get here with input that raises */
+        if (concurrent) {
+                batchconvert(batch, in, out, spares, region, true);
+        } else {
+                TRY
+                        batchconvert(batch, in, out, spares, region, false);
+                EXCEPT(Pnm_Badformat)
+                        fprintf(stderr, "ppmtrans: %s is not a whole "
+                                        "image\n", item->in);
+                        item->failed = true;
+                        if (region != NULL) {
+                                Slab_use(NULL);
+                                Region_reset(region);
+                        }
+                END_TRY;
+        }
+        if (fclose(out) != 0 && !item->failed) {
+                fprintf(stderr, "ppmtrans: can't write %s\n", item->out);
+                item->failed = true;
+        }
+        fclose(in);
+}
+
+static void batchtask(int task, int worker, void *cl)
+{
+        struct batch *batch = cl;
+        batchimage(batch, &batch->items[task], worker, true);
+}
+
+/* the "input output" lines of a manifest; blank and # lines skipped */
+static struct batchitem *readmanifest(const char *manifest, int *nitems)
+{
+        FILE *fp = strcmp(manifest, "-") == 0 ? stdin 
+                                              : fopen(manifest, "r");
+        if (fp == NULL) {
+                fprintf(stderr, "ppmtrans: can't open %s\n", manifest);
+                exit(EXIT_FAILURE);
+        }
+        int n = 0;
+        int room = 16;
+        struct batchitem *items = ALLOC(room * sizeof(*items));
+        char *line = NULL;
+        size_t linesize = 0;
+        int lineno = 0;
+        while (getline(&line, &linesize, fp) >= 0) {
+                lineno++;
+                char *save;
+                char *in = strtok_r(line, " \t\r\n", &save);
+                if (in == NULL || *in == '#') {
+                        continue;
+                }
+                char *out = strtok_r(NULL, " \t\r\n", &save);
+                if (out == NULL || strtok_r(NULL, " \t\r\n", &save)) {
+                        fprintf(stderr, "ppmtrans: %s:%d: expected an input "
+                                        "and an output\n", manifest, lineno);
+                        exit(EXIT_FAILURE);
+                }
+                if (n == room) {
+                        room *= 2;
+                        RESIZE(items, room * sizeof(*items));
+                }
+                items[n].in = strcpy(ALLOC(strlen(in) + 1), in);
+                items[n].out = strcpy(ALLOC(strlen(out) + 1), out);
+                items[n].deferred = false;
+                items[n].failed = false;
+                n++;
+        }
+        free(line);
+        if (fp != stdin) {
+                fclose(fp);
+        }
+        *nitems = n;
+        return items;
+}
+
+/**********runbatch********
+ *
+ * Transforms every image a manifest names, in one process
+ * Inputs: the batch (its transform and engine already set), the
+ *      manifest's name ("-" for stdin), the number of threads and
+ *      whether to pin them, and the -time file or NULL
+ * Return: true if every image was written
+ * 
+ * Notes:
+ *      Each line of the manifest is an input file and an output file.
+ *      Every worker keeps the source and destination arrays of the
+ *      last image it did, and the next image of the same shape is read
+ *      and written through them, so a run of same-sized images only
+ *      allocates (and faults in) its arrays once a worker. With more
+ *      than one thread, small P6 files are done side by side, one
+ *      image a worker, since each is too small to share out well (a
+ *      file is small when it would give Parallel_transform fewer than
+ *      four half-L2 bands a worker). The rest (big images, and input
+ *      Pnm_ppmread has to read, as netpbm isn't thread safe) are done
+ *      afterwards one at a time, each split across every worker.
+ *      An input that is truncated or malformed fails just its own line
+ ************************/
+bool runbatch(struct batch *batch, const char *manifest, int nthreads,
+              bool pin, char *time_file_name, const char *arena)
+{
+        batch->items = readmanifest(manifest, &batch->nitems);
+        batch->pool = nthreads != 1 ? Threadpool_new(nthreads, pin) : NULL;
+        int nworkers = batch->pool != NULL ? Threadpool_size(batch->pool)
+                                           : 1;
+        batch->small = (size_t)2 * nworkers * CacheInfo_size(2);
+        batch->spares = CALLOC(nworkers, sizeof(struct spares));
+        batch->regions = NULL;
+        if (arena != NULL) {
+                batch->regions = ALLOC(nworkers * sizeof(Region_T));
+                for (int w = 0; w < nworkers; w++) {
+                        batch->regions[w] = Region_new(0, 
+                                                       regionpages(arena));
+                }
+        }
+
+        struct timespec start, stop;
+        struct rusage usage_start, usage_stop;
+        getrusage(RUSAGE_SELF, &usage_start);
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        if (batch->pool != NULL) {
+                Threadpool_run(batch->pool, batch->nitems, batchtask, 
+                               batch);
+        }
+        for (int i = 0; i < batch->nitems; i++) {
+                struct batchitem *item = &batch->items[i];
+                if (batch->pool == NULL || item->deferred) {
+                        batchimage(batch, item, 0, false);
+                }
+        }
+        clock_gettime(CLOCK_MONOTONIC, &stop);
+        getrusage(RUSAGE_SELF, &usage_stop);
+
+        bool ok = true;
+        for (int i = 0; i < batch->nitems; i++) {
+                ok = ok && !batch->items[i].failed;
+                FREE(batch->items[i].in);
+                FREE(batch->items[i].out);
+        }
+        for (int w = 0; w < nworkers; w++) {
+                if (batch->spares[w].src != NULL) {
+                        batch->methods->free(&batch->spares[w].src);
+                }
+                if (batch->spares[w].dst != NULL) {
+                        batch->methods->free(&batch->spares[w].dst);
+                }
+        }
+        if (time_file_name != NULL) {
+                FILE *timingOutput = fopen(time_file_name, "a");
+                if (timingOutput == NULL) {
+                        ok = false;
+                } else {
+                        double wall = (stop.tv_sec - start.tv_sec) * 1e9 +
+                                      (stop.tv_nsec - start.tv_nsec);
+                        fprintf(timingOutput, "Batch Wall Time: %0.f ns, "
+                                "Images: %d, Threads: %d\n", wall,
+                                batch->nitems, nworkers);
+                        reportfaults(timingOutput, &usage_start, 
+                                     &usage_stop);
+                        fclose(timingOutput);
+                }
+        }
+        if (batch->regions != NULL) {
+                /* the workers' regions added up, but the peak is one
+                   worker's */
+                struct Region_stats total;
+                memset(&total, 0, sizeof(total));
+                for (int w = 0; w < nworkers; w++) {
+                        struct Region_stats st = 
+                                Region_stats(batch->regions[w]);
+                        total.allocs += st.allocs;
+                        total.resets += st.resets;
+                        total.mappings += st.mappings;
+                        total.mapped += st.mapped;
+                        total.peak = st.peak > total.peak ? st.peak 
+                                                          : total.peak;
+                        total.hugefallback |= st.hugefallback;
+                        Region_free(&batch->regions[w]);
+                }
+                if (time_file_name != NULL) {
+                        reportregion(time_file_name, total);
+                }
+                FREE(batch->regions);
+        }
+        FREE(batch->spares);
+        FREE(batch->items);
+        if (batch->pool != NULL) {
+                Threadpool_free(&batch->pool);
+        }
+        return ok;
+}
+
 
 /**********applyrotation90********
  *
@@ -283,10 +1095,10 @@ void applyrotation90(int col, int row, A2Methods_UArray2 currArray, void* curr,
 {        
         Pnm_ppm PpmImage = (Pnm_ppm) newArray;
         assert(PpmImage != NULL);
-        int height = PpmImage->methods->height(currArray);
-        Pnm_rgb currPixel = (Pnm_rgb) curr;
-        *(Pnm_rgb) PpmImage->methods->at(PpmImage->pixels, (height - row - 1),
-                                                col) = *currPixel; 
+        int height = PpmImage->width;        /* of the source */
+        memcpy(PpmImage->methods->at(PpmImage->pixels, (height - row - 1),
+                                                col), curr,
+               PpmImage->methods->size(currArray)); 
 }
 
 /**********applyrotation180********
@@ -305,11 +1117,11 @@ void applyrotation180(int col, int row, A2Methods_UArray2 currArray,
 {       
         Pnm_ppm PpmImage = (Pnm_ppm) newArray;
         assert(PpmImage != NULL);
-        int height = PpmImage->methods->height(currArray);
-        int width = PpmImage->methods->width(currArray);
-        Pnm_rgb currPixel = (Pnm_rgb) curr;
-        *(Pnm_rgb) PpmImage->methods->at(PpmImage->pixels, (width - col - 1),
-                                (height - row - 1)) = *currPixel; 
+        int height = PpmImage->height;
+        int width = PpmImage->width;
+        memcpy(PpmImage->methods->at(PpmImage->pixels, (width - col - 1),
+                                (height - row - 1)), curr,
+               PpmImage->methods->size(currArray)); 
 }
 
 /**********applyrotation0********
@@ -326,12 +1138,11 @@ void applyrotation180(int col, int row, A2Methods_UArray2 currArray,
 void applyrotation0(int col, int row, A2Methods_UArray2 currArray, void* curr,
                                                 void* newArray )
 {
-        (void)currArray;
         Pnm_ppm PpmImage = (Pnm_ppm) newArray;
         assert(PpmImage != NULL);
-        Pnm_rgb currPixel = (Pnm_rgb) curr;
-        *(Pnm_rgb) PpmImage->methods->at(PpmImage->pixels, col, 
-                                                row) = *currPixel; 
+        memcpy(PpmImage->methods->at(PpmImage->pixels, col, 
+                                                row), curr,
+               PpmImage->methods->size(currArray)); 
 }
 
 /**********applyrotation270********
@@ -350,10 +1161,10 @@ void applyrotation270(int col, int row, A2Methods_UArray2 currArray,
 {        
         Pnm_ppm PpmImage = (Pnm_ppm) newArray;
         assert(PpmImage != NULL);
-        int width = PpmImage->methods->width(currArray);
-        Pnm_rgb currPixel = (Pnm_rgb) curr;
-        *(Pnm_rgb) PpmImage->methods->at(PpmImage->pixels, row, 
-                                        (width - col - 1)) = *currPixel; 
+        int width = PpmImage->height;        /* of the source */
+        memcpy(PpmImage->methods->at(PpmImage->pixels, row, 
+                                        (width - col - 1)), curr,
+               PpmImage->methods->size(currArray)); 
 }
 
 /**********applyhorizontal********
@@ -371,10 +1182,10 @@ void applyhorizontal(int col, int row, A2Methods_UArray2 currArray,
                                         void* curr, void* newArray )
 {        
         Pnm_ppm PpmImage = (Pnm_ppm) newArray;
-        Pnm_rgb currPixel = (Pnm_rgb) curr;
-        int width = PpmImage->methods->width(currArray);
-        *(Pnm_rgb) PpmImage->methods->at(PpmImage->pixels, 
-                                ((width - 1) - col), row) = *currPixel; 
+        int width = PpmImage->width;
+        memcpy(PpmImage->methods->at(PpmImage->pixels, 
+                                ((width - 1) - col), row), curr,
+               PpmImage->methods->size(currArray)); 
 }
 
 /**********applyvertical********
@@ -392,10 +1203,10 @@ void applyvertical(int col, int row, A2Methods_UArray2 currArray, void* curr,
                                                 void* newArray )
 {        
         Pnm_ppm PpmImage = (Pnm_ppm) newArray;
-        Pnm_rgb currPixel = (Pnm_rgb) curr;
-        int height = PpmImage->methods->height(currArray);
-        *(Pnm_rgb) PpmImage->methods->at(PpmImage->pixels, 
-                                        col, (height - 1 - row)) = *currPixel; 
+        int height = PpmImage->height;
+        memcpy(PpmImage->methods->at(PpmImage->pixels, 
+                                        col, (height - 1 - row)), curr,
+               PpmImage->methods->size(currArray)); 
 }
 
 /**********applytranspose********
@@ -412,9 +1223,69 @@ void applyvertical(int col, int row, A2Methods_UArray2 currArray, void* curr,
 void applytranspose(int col, int row, A2Methods_UArray2 currArray, void* curr,
                                                 void* newArray )
 {        
-        (void)currArray;
         Pnm_ppm PpmImage = (Pnm_ppm) newArray;
-        Pnm_rgb currPixel = (Pnm_rgb) curr;
-        *(Pnm_rgb) PpmImage->methods->at(PpmImage->pixels, row, 
-                                                col) = *currPixel;  
+        memcpy(PpmImage->methods->at(PpmImage->pixels, row, 
+                                                col), curr,
+               PpmImage->methods->size(currArray));  
+}
+
+/**********applytransverse********
+ *
+ * apply function for doing a transverse
+ * Inputs: col, row, A2Methods_UArray2 array, curr value, cl pointer
+ * Return: none
+ * 
+ * Expects:
+ *      *newArray to be a Pnm_ppm
+ * Notes:
+ *      Transpose across the other diagonal, the same as a transpose
+ *      followed by rotate 180
+ ************************/
+void applytransverse(int col, int row, A2Methods_UArray2 currArray,
+                                                void* curr, void* newArray )
+{        
+        Pnm_ppm PpmImage = (Pnm_ppm) newArray;
+        assert(PpmImage != NULL);
+        int width = PpmImage->height;        /* of the source */
+        int height = PpmImage->width;
+        memcpy(PpmImage->methods->at(PpmImage->pixels, height - row - 1,
+                                     width - col - 1), curr,
+               PpmImage->methods->size(currArray)); 
+}
+
+/**********reportregion********
+ *
+ * Appends what an -arena region did to the timing file
+ * Inputs: the timing file's name, and the region's counts
+ * Return: none
+ ************************/
+void reportregion(const char *time_file_name, struct Region_stats stats)
+{
+        FILE *timingOutput = fopen(time_file_name, "a");
+        if (timingOutput == NULL) {
+                return;
+        }
+        fprintf(timingOutput, "Arena: %lu allocations, %lu resets, "
+                "%lu mappings of %zu bytes, peak %zu bytes%s\n",
+                stats.allocs, stats.resets, stats.mappings, stats.mapped,
+                stats.peak, stats.hugefallback ? ", no huge pages" : "");
+        fclose(timingOutput);
+}
+
+/**********reportfaults********
+ *
+ * Writes the page faults taken between two getrusage calls
+ * Inputs: the open timing file, and the usage before and after
+ * Return: none
+ * 
+ * Notes:
+ *      Minor faults are first touches of new pages, which is what
+ *      -huge-pages cuts down; major faults had to wait for the disk
+ ************************/
+void reportfaults(FILE *timingOutput, struct rusage *start, 
+                  struct rusage *stop)
+{
+        fprintf(timingOutput, "Page Faults: %ld minor, %ld major\n",
+                stop->ru_minflt - start->ru_minflt,
+                stop->ru_majflt - start->ru_majflt);
 }
@@ -0,0 +1,230 @@
+/*
+ *     region.c
+ *
+ *     locality
+ *
+ *     This is the implementation file for our Region interface.
+ *
+ *     A region is a list of chunks, each one mmap. Allocation bumps an
+ *     offset through the current chunk; reset puts every offset back to
+ *     zero. Each chunk remembers how far it has ever been used, since
+ *     past that it is still zero from mmap and needs no clearing.
+ *
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "assert.h"
+#include "mem.h"
+#include "region.h"
+
+#define T Region_T
+
+#define DEFAULT_CHUNK ((size_t)64 << 20)
+#define HUGE_PAGE ((size_t)2 << 20)
+
+struct chunk {
+        char *base;
+        size_t size;
+        size_t used;            /* bytes handed out since the last reset */
+        size_t dirty;           /* bytes ever handed out */
+};
+
+struct T {
+        size_t chunksize;
+        Region_pages pages;
+        struct chunk *chunks;
+        int nchunks;
+        int room;
+        int current;            /* the chunk allocation is bumping through */
+        struct Region_stats stats;
+};
+
+static inline size_t round_up(size_t n, size_t unit)
+{
+        return (n + unit - 1) / unit * unit;
+}
+
+static char *map(size_t size, int flags)
+{
+        return mmap(NULL, size, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | flags, -1, 0);
+}
+
+/* size bytes starting on a huge page boundary, marked for THP */
+static char *map_thp(size_t size)
+{
+        size_t extra = size + HUGE_PAGE;
+        char *raw = map(extra, 0);
+        assert(raw != MAP_FAILED);
+        char *base = (char *)round_up((uintptr_t)raw, HUGE_PAGE);
+        if (base > raw) {
+                munmap(raw, base - raw);
+        }
+        if (raw + extra > base + size) {
+                munmap(base + size, raw + extra - (base + size));
+        }
+#ifdef MADV_HUGEPAGE
+        madvise(base, size, MADV_HUGEPAGE);
+#endif
+        return base;
+}
+
+static size_t map_size(size_t size, Region_pages pages)
+{
+        return round_up(size, pages == REGION_PAGES 
+                              ? (size_t)sysconf(_SC_PAGESIZE) : HUGE_PAGE);
+}
+
+void *Region_map(size_t size, Region_pages pages, bool *fellback)
+{
+        size = map_size(size, pages);
+        char *base = MAP_FAILED;
+        if (pages == REGION_HUGETLB) {
+#ifdef MAP_HUGETLB
+                base = map(size, MAP_HUGETLB);
+#endif
+                if (base == MAP_FAILED && fellback != NULL) {
+                        *fellback = true;
+                }
+        }
+        if (base == MAP_FAILED && pages == REGION_THP) {
+                base = map_thp(size);
+        } else if (base == MAP_FAILED) {
+                base = map(size, 0);
+                assert(base != MAP_FAILED);
+        }
+        return base;
+}
+
+void Region_unmap(void *p, size_t size, Region_pages pages)
+{
+        munmap(p, map_size(size, pages));
+}
+
+/* maps a chunk with room for at least nbytes, and returns its index */
+static int new_chunk(T region, size_t nbytes)
+{
+        size_t want = nbytes > region->chunksize ? nbytes 
+                                                 : region->chunksize;
+        size_t size = map_size(want, region->pages);
+        char *base = Region_map(size, region->pages, 
+                                &region->stats.hugefallback);
+
+        if (region->chunks == NULL) {
+                region->room = 4;
+                region->chunks = ALLOC(region->room * sizeof(struct chunk));
+        } else if (region->nchunks == region->room) {
+                region->room *= 2;
+                RESIZE(region->chunks,
+                       region->room * (long)sizeof(struct chunk));
+        }
+        struct chunk *c = &region->chunks[region->nchunks];
+        c->base = base;
+        c->size = size;
+        c->used = 0;
+        c->dirty = 0;
+        region->stats.mappings++;
+        region->stats.mapped += size;
+        return region->nchunks++;
+}
+
+T Region_new(size_t chunk, Region_pages pages)
+{
+        T region;
+        NEW(region);
+        region->chunksize = chunk > 0 ? chunk : DEFAULT_CHUNK;
+        region->pages = pages;
+        region->chunks = NULL;
+        region->nchunks = 0;
+        region->room = 0;
+        region->current = 0;
+        memset(&region->stats, 0, sizeof(region->stats));
+        return region;
+}
+
+void Region_free(T *region)
+{
+        assert(region != NULL && *region != NULL);
+        T r = *region;
+        for (int i = 0; i < r->nchunks; i++) {
+                Region_unmap(r->chunks[i].base, r->chunks[i].size, 
+                             r->pages);
+        }
+        if (r->chunks != NULL) {
+                FREE(r->chunks);
+        }
+        FREE(*region);
+}
+
+void *Region_alloc(T region, size_t nbytes, size_t align)
+{
+        assert(region != NULL);
+        assert(align > 0 && (align & (align - 1)) == 0);
+        nbytes = nbytes > 0 ? nbytes : 1;
+
+        int i = region->current;
+        size_t at = 0;
+        for (; i < region->nchunks; i++) {
+                at = round_up(region->chunks[i].used, align);
+                if (at + nbytes <= region->chunks[i].size) {
+                        break;
+                }
+        }
+        if (i == region->nchunks) {
+                i = new_chunk(region, nbytes);
+                at = 0;
+        }
+        region->current = i;
+
+        struct chunk *c = &region->chunks[i];
+        char *p = c->base + at;
+        if (at < c->dirty) {
+                size_t end = at + nbytes < c->dirty ? at + nbytes : c->dirty;
+                memset(p, 0, end - at);
+        }
+        region->stats.inuse += at + nbytes - c->used;
+        c->used = at + nbytes;
+        if (c->used > c->dirty) {
+                c->dirty = c->used;
+        }
+
+        region->stats.allocs++;
+        if (region->stats.inuse > region->stats.peak) {
+                region->stats.peak = region->stats.inuse;
+        }
+        return p;
+}
+
+void Region_reset(T region)
+{
+        assert(region != NULL);
+        for (int i = 0; i < region->nchunks; i++) {
+                region->chunks[i].used = 0;
+        }
+        region->current = 0;
+        region->stats.inuse = 0;
+        region->stats.resets++;
+}
+
+bool Region_owns(T region, const void *p)
+{
+        assert(region != NULL);
+        const char *q = p;
+        for (int i = 0; i < region->nchunks; i++) {
+                struct chunk *c = &region->chunks[i];
+                if (q >= c->base && q < c->base + c->size) {
+                        return true;
+                }
+        }
+        return false;
+}
+
+struct Region_stats Region_stats(T region)
+{
+        assert(region != NULL);
+        return region->stats;
+}
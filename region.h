@@ -0,0 +1,139 @@
+/*
+ *     region.h
+ *
+ *     locality
+ *
+ *     This is the header file for the Region interface, an arena that
+ *     hands out memory from a few large mappings and takes it all back
+ *     at once. (CII's Arena is a different thing, hence the name.)
+ *
+ */
+
+#ifndef REGION_INCLUDED
+#define REGION_INCLUDED
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#define T Region_T
+typedef struct T *T;
+
+/* what a region's mappings are backed by */
+typedef enum Region_pages {
+        REGION_PAGES,           /* ordinary pages */
+        REGION_THP,             /* transparent huge pages, by madvise */
+        REGION_HUGETLB          /* MAP_HUGETLB, or ordinary if there are
+                                   no huge pages to be had */
+} Region_pages;
+
+/* what a region has done since it was made */
+struct Region_stats {
+        unsigned long allocs;   /* Region_alloc calls */
+        unsigned long resets;
+        unsigned long mappings; /* mmaps, one a chunk */
+        size_t inuse;           /* bytes handed out since the last reset */
+        size_t peak;            /* most bytes ever in use at once */
+        size_t mapped;          /* bytes of chunks */
+        bool hugefallback;      /* REGION_HUGETLB had to use small pages */
+};
+
+
+/**********Region_new********
+ *
+ * Makes an empty region
+ * Inputs: the size of the chunks it maps (0 for a default), and what
+ *      backs them
+ * Return: the new region
+ * Notes:
+ *      Nothing is mapped until the first allocation. Chunks are rounded
+ *      up to whole pages, or whole 2MB pages for huge page backing. A
+ *      region may be used by one thread at a time
+ *
+ ************************/
+T Region_new(size_t chunk, Region_pages pages);
+
+
+/**********Region_free********
+ *
+ * Unmaps every chunk of a region and frees it
+ * Inputs: pointer to a region
+ * Return: nothing
+ * Expects: *region to be nonnull
+ *
+ ************************/
+void Region_free(T *region);
+
+
+/**********Region_alloc********
+ *
+ * Hands out zero-filled memory from a region
+ * Inputs: the region, number of bytes, and the alignment wanted
+ * Return: the memory, which stays good until the next Region_reset or
+ *      Region_free
+ * Expects: align to be a power of two no bigger than a page
+ * Notes:
+ *      Bumps a pointer through the current chunk. A request that doesn't
+ *      fit goes to the next chunk it fits in from the start, or to a new
+ *      chunk (at least big enough for it). Memory a chunk has never
+ *      handed out is still zero from mmap, so only bytes reused after a
+ *      reset are cleared. Will throw a checked runtime error if the
+ *      memory can't be mapped
+ *
+ ************************/
+void *Region_alloc(T region, size_t nbytes, size_t align);
+
+
+/**********Region_reset********
+ *
+ * Takes back everything a region has handed out, keeping its chunks
+ * Inputs: the region
+ * Return: nothing
+ * Notes:
+ *      The next allocations reuse the same chunks from the start, so a
+ *      run of same-sized images maps its memory once
+ *
+ ************************/
+void Region_reset(T region);
+
+
+/**********Region_owns********
+ *
+ * Says whether p lies in one of a region's chunks
+ *
+ ************************/
+bool Region_owns(T region, const void *p);
+
+
+/**********Region_map********
+ *
+ * Maps zero-filled memory of a given kind, for callers that manage it
+ * themselves
+ * Inputs: number of bytes, the kind of pages, and a flag to set if huge
+ *      pages were asked for and not had (or NULL)
+ * Return: the mapping, page aligned (2MB aligned for huge pages)
+ * Notes:
+ *      Huge page mappings are rounded up to a whole 2MB. REGION_HUGETLB
+ *      falls back to ordinary pages. Will throw a checked runtime error
+ *      if nothing can be mapped
+ *
+ ************************/
+void *Region_map(size_t size, Region_pages pages, bool *fellback);
+
+
+/**********Region_unmap********
+ *
+ * Undoes Region_map, given the same size and kind of pages
+ *
+ ************************/
+void Region_unmap(void *p, size_t size, Region_pages pages);
+
+
+/**********Region_stats********
+ *
+ * Returns a region's counts (see struct Region_stats)
+ *
+ ************************/
+struct Region_stats Region_stats(T region);
+
+#undef T
+#endif
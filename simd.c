@@ -0,0 +1,369 @@
+/*
+ *     simd.c
+ *
+ *     locality
+ *
+ *     This is the implementation file for our Simd interface.
+ *
+ */
+
+#include <stddef.h>
+#include <string.h>
+
+#include "assert.h"
+#include "simd.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_X86 1
+#endif
+
+typedef struct Pnm_rgb Pixel;
+
+void Simd_transpose4_scalar(void *const dst[4], const void *const src[4])
+{
+        for (int r = 0; r < 4; r++) {
+                for (int c = 0; c < 4; c++) {
+                        ((Pixel *)dst[c])[r] = ((const Pixel *)src[r])[c];
+                }
+        }
+}
+
+/* one per element size, so each copy is a constant size */
+#define SCALAR_TILE(SIZE)                                               \
+static void transpose4_scalar##SIZE(void *const dst[4],                 \
+                                    const void *const src[4])           \
+{                                                                       \
+        for (int r = 0; r < 4; r++) {                                   \
+                for (int c = 0; c < 4; c++) {                           \
+                        memcpy((char *)dst[c] + r * (SIZE),             \
+                               (const char *)src[r] + c * (SIZE),       \
+                               (SIZE));                                 \
+                }                                                       \
+        }                                                               \
+}
+
+SCALAR_TILE(1)  SCALAR_TILE(2)  SCALAR_TILE(3)  SCALAR_TILE(4)
+SCALAR_TILE(5)  SCALAR_TILE(6)  SCALAR_TILE(7)  SCALAR_TILE(8)
+SCALAR_TILE(9)  SCALAR_TILE(10) SCALAR_TILE(11) SCALAR_TILE(12)
+SCALAR_TILE(13) SCALAR_TILE(14) SCALAR_TILE(15) SCALAR_TILE(16)
+
+static Simd_tilefun *const scalar_tiles[17] = {
+        NULL,
+        transpose4_scalar1,  transpose4_scalar2,  transpose4_scalar3,
+        transpose4_scalar4,  transpose4_scalar5,  transpose4_scalar6,
+        transpose4_scalar7,  transpose4_scalar8,  transpose4_scalar9,
+        transpose4_scalar10, transpose4_scalar11, transpose4_scalar12,
+        transpose4_scalar13, transpose4_scalar14, transpose4_scalar15,
+        transpose4_scalar16
+};
+
+void Simd_widen_rgb8_scalar(Pixel *dst, const unsigned char *src, int n)
+{
+        for (int k = 0; k < n; k++, src += 3) {
+                dst[k].red = src[0];
+                dst[k].green = src[1];
+                dst[k].blue = src[2];
+        }
+}
+
+void Simd_narrow_rgb8_scalar(unsigned char *dst, const Pixel *src, int n)
+{
+        for (int k = 0; k < n; k++, dst += 3) {
+                dst[0] = src[k].red;
+                dst[1] = src[k].green;
+                dst[2] = src[k].blue;
+        }
+}
+
+#ifdef HAVE_X86
+
+/*
+ * Four pixels are 12 unsigned ints, which we load as three 4-lane
+ * vectors a = [R0 G0 B0 R1], b = [G1 B1 R2 G2], c = [B2 R3 G3 B3]. The
+ * float shuffles only move bits around, so treating the channels as
+ * floats is harmless.
+ */
+#define SHUF(x, y, i0, i1, i2, i3) \
+        _mm_shuffle_ps((x), (y), _MM_SHUFFLE((i3), (i2), (i1), (i0)))
+
+static inline __attribute__((always_inline))
+void split(const Pixel *p, __m128 *red, __m128 *green, __m128 *blue)
+{
+        const float *f = (const float *)p;
+        __m128 a = _mm_loadu_ps(f);
+        __m128 b = _mm_loadu_ps(f + 4);
+        __m128 c = _mm_loadu_ps(f + 8);
+
+        __m128 t = SHUF(b, c, 2, 3, 0, 1);            /* R2 G2 B2 R3 */
+        *red = SHUF(a, t, 0, 3, 0, 3);
+        __m128 x = SHUF(a, b, 1, 1, 0, 0);            /* G0 G0 G1 G1 */
+        __m128 y = SHUF(b, c, 3, 3, 2, 2);            /* G2 G2 G3 G3 */
+        *green = SHUF(x, y, 0, 2, 0, 2);
+        x = SHUF(a, b, 2, 2, 1, 1);                   /* B0 B0 B1 B1 */
+        y = SHUF(c, c, 0, 0, 3, 3);                   /* B2 B2 B3 B3 */
+        *blue = SHUF(x, y, 0, 2, 0, 2);
+}
+
+static inline __attribute__((always_inline))
+void join(Pixel *p, __m128 red, __m128 green, __m128 blue)
+{
+        float *f = (float *)p;
+        __m128 x = SHUF(red, green, 0, 0, 0, 0);      /* R0 R0 G0 G0 */
+        __m128 y = SHUF(blue, red, 0, 0, 1, 1);       /* B0 B0 R1 R1 */
+        _mm_storeu_ps(f, SHUF(x, y, 0, 2, 0, 2));
+        x = SHUF(green, blue, 1, 1, 1, 1);            /* G1 G1 B1 B1 */
+        y = SHUF(red, green, 2, 2, 2, 2);             /* R2 R2 G2 G2 */
+        _mm_storeu_ps(f + 4, SHUF(x, y, 0, 2, 0, 2));
+        x = SHUF(blue, red, 2, 2, 3, 3);              /* B2 B2 R3 R3 */
+        y = SHUF(green, blue, 3, 3, 3, 3);            /* G3 G3 B3 B3 */
+        _mm_storeu_ps(f + 8, SHUF(x, y, 0, 2, 0, 2));
+}
+
+static inline __attribute__((always_inline))
+void transpose4(void *const dst[4], const void *const src[4])
+{
+        __m128 r0, r1, r2, r3, g0, g1, g2, g3, b0, b1, b2, b3;
+        split(src[0], &r0, &g0, &b0);
+        split(src[1], &r1, &g1, &b1);
+        split(src[2], &r2, &g2, &b2);
+        split(src[3], &r3, &g3, &b3);
+        _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+        _MM_TRANSPOSE4_PS(g0, g1, g2, g3);
+        _MM_TRANSPOSE4_PS(b0, b1, b2, b3);
+        join(dst[0], r0, g0, b0);
+        join(dst[1], r1, g1, b1);
+        join(dst[2], r2, g2, b2);
+        join(dst[3], r3, g3, b3);
+}
+
+__attribute__((target("sse2")))
+void Simd_transpose4_sse2(void *const dst[4], const void *const src[4])
+{
+        transpose4(dst, src);
+}
+
+/*
+ * The same shuffle network with VEX encodings. A wider 8 x 8 tile
+ * doesn't pay for 12 byte pixels: splitting channels across 128 bit
+ * lanes costs more permutes than the wider transpose saves
+ */
+__attribute__((target("avx2")))
+void Simd_transpose4_avx2(void *const dst[4], const void *const src[4])
+{
+        transpose4(dst, src);
+}
+
+/* 1 byte elements (one channel of a planar image): the whole tile is
+   one vector, so one byte shuffle transposes it */
+__attribute__((target("ssse3")))
+void Simd_transpose4_x8_ssse3(void *const dst[4], const void *const src[4])
+{
+        int rows[4];
+        for (int r = 0; r < 4; r++) {
+                memcpy(&rows[r], src[r], 4);
+        }
+        __m128i tile = _mm_setr_epi32(rows[0], rows[1], rows[2], rows[3]);
+        tile = _mm_shuffle_epi8(tile, _mm_setr_epi8(0, 4, 8, 12, 1, 5, 9,
+                                                    13, 2, 6, 10, 14, 3, 7,
+                                                    11, 15));
+        for (int c = 0; c < 4; c++) {
+                rows[c] = _mm_cvtsi128_si32(tile);
+                memcpy(dst[c], &rows[c], 4);
+                tile = _mm_srli_si128(tile, 4);
+        }
+}
+
+/* 2 byte elements: interleaving pairs of rows, then pairs of those,
+   leaves each destination row in one half of a vector */
+__attribute__((target("sse2")))
+void Simd_transpose4_x16_sse2(void *const dst[4], const void *const src[4])
+{
+        __m128i r0 = _mm_loadl_epi64((const __m128i *)src[0]);
+        __m128i r1 = _mm_loadl_epi64((const __m128i *)src[1]);
+        __m128i r2 = _mm_loadl_epi64((const __m128i *)src[2]);
+        __m128i r3 = _mm_loadl_epi64((const __m128i *)src[3]);
+        __m128i a = _mm_unpacklo_epi16(r0, r1);
+        __m128i b = _mm_unpacklo_epi16(r2, r3);
+        __m128i lo = _mm_unpacklo_epi32(a, b);
+        __m128i hi = _mm_unpackhi_epi32(a, b);
+        _mm_storel_epi64((__m128i *)dst[0], lo);
+        _mm_storel_epi64((__m128i *)dst[1], _mm_srli_si128(lo, 8));
+        _mm_storel_epi64((__m128i *)dst[2], hi);
+        _mm_storel_epi64((__m128i *)dst[3], _mm_srli_si128(hi, 8));
+}
+
+/* 4 byte elements: each row is one vector, and the float transpose
+   moves whole lanes */
+__attribute__((target("sse2")))
+void Simd_transpose4_x32_sse2(void *const dst[4], const void *const src[4])
+{
+        __m128 r0 = _mm_loadu_ps(src[0]);
+        __m128 r1 = _mm_loadu_ps(src[1]);
+        __m128 r2 = _mm_loadu_ps(src[2]);
+        __m128 r3 = _mm_loadu_ps(src[3]);
+        _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+        _mm_storeu_ps(dst[0], r0);
+        _mm_storeu_ps(dst[1], r1);
+        _mm_storeu_ps(dst[2], r2);
+        _mm_storeu_ps(dst[3], r3);
+}
+
+/* 8 byte elements: each row is two vectors of two, and the tile is four
+   2 x 2 tiles, each transposed with one pair of unpacks */
+__attribute__((target("sse2")))
+void Simd_transpose4_x64_sse2(void *const dst[4], const void *const src[4])
+{
+        __m128i lo[4], hi[4];
+        for (int r = 0; r < 4; r++) {
+                lo[r] = _mm_loadu_si128((const __m128i *)src[r]);
+                hi[r] = _mm_loadu_si128((const __m128i *)src[r] + 1);
+        }
+        __m128i *d0 = dst[0], *d1 = dst[1], *d2 = dst[2], *d3 = dst[3];
+        _mm_storeu_si128(d0,     _mm_unpacklo_epi64(lo[0], lo[1]));
+        _mm_storeu_si128(d0 + 1, _mm_unpacklo_epi64(lo[2], lo[3]));
+        _mm_storeu_si128(d1,     _mm_unpackhi_epi64(lo[0], lo[1]));
+        _mm_storeu_si128(d1 + 1, _mm_unpackhi_epi64(lo[2], lo[3]));
+        _mm_storeu_si128(d2,     _mm_unpacklo_epi64(hi[0], hi[1]));
+        _mm_storeu_si128(d2 + 1, _mm_unpacklo_epi64(hi[2], hi[3]));
+        _mm_storeu_si128(d3,     _mm_unpackhi_epi64(hi[0], hi[1]));
+        _mm_storeu_si128(d3 + 1, _mm_unpackhi_epi64(hi[2], hi[3]));
+}
+
+/* four pixels (12 bytes) at a time; loads never go past src + 3n */
+__attribute__((target("sse4.1")))
+void Simd_widen_rgb8_sse41(Pixel *dst, const unsigned char *src, int n)
+{
+        int k = 0;
+        for (; k + 4 <= n; k += 4, src += 12) {
+                __m128i *d = (__m128i *)&dst[k];
+                for (int q = 0; q < 3; q++) {
+                        int bytes;
+                        memcpy(&bytes, src + 4 * q, 4);
+                        _mm_storeu_si128(d + q, _mm_cvtepu8_epi32(
+                                                _mm_cvtsi32_si128(bytes)));
+                }
+        }
+        Simd_widen_rgb8_scalar(dst + k, src, n - k);
+}
+
+/* eight pixels (24 bytes) at a time */
+__attribute__((target("avx2")))
+void Simd_widen_rgb8_avx2(Pixel *dst, const unsigned char *src, int n)
+{
+        int k = 0;
+        for (; k + 8 <= n; k += 8, src += 24) {
+                __m256i *d = (__m256i *)&dst[k];
+                for (int q = 0; q < 3; q++) {
+                        __m128i bytes = _mm_loadl_epi64(
+                                        (const __m128i *)(src + 8 * q));
+                        _mm256_storeu_si256(d + q, 
+                                            _mm256_cvtepu8_epi32(bytes));
+                }
+        }
+        Simd_widen_rgb8_scalar(dst + k, src, n - k);
+}
+
+/* four pixels at a time; stores never go past dst + 3n */
+__attribute__((target("sse4.1")))
+void Simd_narrow_rgb8_sse41(unsigned char *dst, const Pixel *src, int n)
+{
+        int k = 0;
+        for (; k + 4 <= n; k += 4, dst += 12) {
+                const __m128i *s = (const __m128i *)&src[k];
+                __m128i a = _mm_loadu_si128(s);
+                __m128i b = _mm_loadu_si128(s + 1);
+                __m128i c = _mm_loadu_si128(s + 2);
+                __m128i bytes = _mm_packus_epi16(_mm_packus_epi32(a, b),
+                                                 _mm_packus_epi32(c, c));
+                int last = _mm_cvtsi128_si32(_mm_srli_si128(bytes, 8));
+                _mm_storel_epi64((__m128i *)dst, bytes);
+                memcpy(dst + 8, &last, 4);
+        }
+        Simd_narrow_rgb8_scalar(dst, src + k, n - k);
+}
+
+#endif
+
+Simd_tilefun *Simd_transpose4(void)
+{
+        /* threads may race to fill this in, but they all pick the same */
+        static Simd_tilefun *chosen = NULL;
+        Simd_tilefun *best = __atomic_load_n(&chosen, __ATOMIC_RELAXED);
+        if (best == NULL) {
+#ifdef HAVE_X86
+                __builtin_cpu_init();
+                if (__builtin_cpu_supports("avx2")) {
+                        best = Simd_transpose4_avx2;
+                } else if (__builtin_cpu_supports("sse2")) {
+                        best = Simd_transpose4_sse2;
+                } else {
+                        best = Simd_transpose4_scalar;
+                }
+#else
+                best = Simd_transpose4_scalar;
+#endif
+                __atomic_store_n(&chosen, best, __ATOMIC_RELAXED);
+        }
+        return best;
+}
+
+Simd_tilefun *Simd_transpose4_sized(int size)
+{
+        if ((size_t)size == sizeof(Pixel)) {
+                return Simd_transpose4();
+        }
+        assert(size > 0 && size <= 16);
+#ifdef HAVE_X86
+        __builtin_cpu_init();
+        if (size == 1 && __builtin_cpu_supports("ssse3")) {
+                return Simd_transpose4_x8_ssse3;
+        } else if (size == 2 && __builtin_cpu_supports("sse2")) {
+                return Simd_transpose4_x16_sse2;
+        } else if (size == 4 && __builtin_cpu_supports("sse2")) {
+                return Simd_transpose4_x32_sse2;
+        } else if (size == 8 && __builtin_cpu_supports("sse2")) {
+                return Simd_transpose4_x64_sse2;
+        }
+#endif
+        return scalar_tiles[size];
+}
+
+Simd_widenfun *Simd_widen_rgb8(void)
+{
+        static Simd_widenfun *chosen = NULL;
+        Simd_widenfun *best = __atomic_load_n(&chosen, __ATOMIC_RELAXED);
+        if (best == NULL) {
+#ifdef HAVE_X86
+                __builtin_cpu_init();
+                if (__builtin_cpu_supports("avx2")) {
+                        best = Simd_widen_rgb8_avx2;
+                } else if (__builtin_cpu_supports("sse4.1")) {
+                        best = Simd_widen_rgb8_sse41;
+                } else {
+                        best = Simd_widen_rgb8_scalar;
+                }
+#else
+                best = Simd_widen_rgb8_scalar;
+#endif
+                __atomic_store_n(&chosen, best, __ATOMIC_RELAXED);
+        }
+        return best;
+}
+
+Simd_narrowfun *Simd_narrow_rgb8(void)
+{
+        static Simd_narrowfun *chosen = NULL;
+        Simd_narrowfun *best = __atomic_load_n(&chosen, __ATOMIC_RELAXED);
+        if (best == NULL) {
+#ifdef HAVE_X86
+                __builtin_cpu_init();
+                best = __builtin_cpu_supports("sse4.1") 
+                     ? Simd_narrow_rgb8_sse41 : Simd_narrow_rgb8_scalar;
+#else
+                best = Simd_narrow_rgb8_scalar;
+#endif
+                __atomic_store_n(&chosen, best, __ATOMIC_RELAXED);
+        }
+        return best;
+}
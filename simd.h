@@ -0,0 +1,134 @@
+/*
+ *     simd.h
+ *
+ *     locality
+ *
+ *     This is the header file for the Simd interface: in-register
+ *     transposes of 4 x 4 tiles of pixels for the 90, 270 and
+ *     transpose kernels, and the conversions between packed P6 bytes
+ *     and Pnm_rgb pixels for the image reader and writer.
+ *
+ */
+
+#ifndef SIMD_INCLUDED
+#define SIMD_INCLUDED
+
+#include "pnm.h"
+
+/*
+ * A tile function moves a 4 x 4 tile of elements: src[r] points at 4
+ * contiguous elements of source row r, dst[c] points at 4 contiguous
+ * elements of destination row c, and on return dst[c][r] == src[r][c].
+ * Each function is for one element size
+ */
+typedef void Simd_tilefun(void *const dst[4], const void *const src[4]);
+
+
+/**********Simd_transpose4********
+ *
+ * Returns the fastest 4 x 4 tile transpose of Pnm_rgb pixels this CPU
+ * can run
+ * Inputs: none
+ * Return: the AVX2 version if the CPU has AVX2, else the SSE2 version,
+ *      else (off x86) the scalar version
+ *
+ * Notes:
+ *      The CPU is only checked the first time. The SSE2 and AVX2
+ *      versions load each source row into registers, split it into red,
+ *      green and blue lanes with shuffles, transpose each channel, and
+ *      interleave the channels back into destination rows
+ *
+ ************************/
+Simd_tilefun *Simd_transpose4(void);
+
+/* the individual versions, for testing and timing */
+extern Simd_tilefun Simd_transpose4_scalar;
+#if defined(__x86_64__) || defined(__i386__)
+extern Simd_tilefun Simd_transpose4_sse2;
+extern Simd_tilefun Simd_transpose4_avx2;
+#endif
+
+
+/**********Simd_transpose4_sized********
+ *
+ * Returns the fastest 4 x 4 tile transpose for elements of size bytes
+ * Inputs: the element size
+ * Return: Simd_transpose4() for Pnm_rgb pixels; on x86, an SSSE3
+ *      version for 1 byte elements and SSE2 ones for 2, 4 and 8 byte
+ *      elements; a plain C version for any other size from 1 to 16
+ * Expects: 0 < size <= 16
+ * Notes:
+ *      A tile of 1 byte samples (planar images) is a single vector, and
+ *      goes through one byte shuffle. 2, 4 and 8 byte elements (16 bit
+ *      planes, padded RGB) fill whole lanes, so their tiles transpose
+ *      with unpacks alone. 3 and 6 byte elements straddle lanes, and are
+ *      copied one element at a time
+ *
+ ************************/
+Simd_tilefun *Simd_transpose4_sized(int size);
+
+#if defined(__x86_64__) || defined(__i386__)
+extern Simd_tilefun Simd_transpose4_x8_ssse3;
+extern Simd_tilefun Simd_transpose4_x16_sse2;
+extern Simd_tilefun Simd_transpose4_x32_sse2;
+extern Simd_tilefun Simd_transpose4_x64_sse2;
+#endif
+
+/*
+ * A widen function turns n pixels of packed 8 bit samples (3n bytes,
+ * red green blue, as they sit in a P6 file) into n Pnm_rgb pixels
+ */
+typedef void Simd_widenfun(struct Pnm_rgb *dst, const unsigned char *src,
+                           int n);
+
+
+/**********Simd_widen_rgb8********
+ *
+ * Returns the fastest widen function this CPU can run
+ * Inputs: none
+ * Return: the AVX2 version if the CPU has AVX2, else the SSE4.1 version
+ *      if it has SSE4.1, else the scalar version
+ *
+ * Notes:
+ *      A Pnm_rgb is the same samples in the same order, each zero
+ *      extended to 32 bits, so the vector versions are just byte to
+ *      int zero extensions of 4 (SSE4.1) or 8 (AVX2) bytes at a time
+ *
+ ************************/
+Simd_widenfun *Simd_widen_rgb8(void);
+
+extern Simd_widenfun Simd_widen_rgb8_scalar;
+#if defined(__x86_64__) || defined(__i386__)
+extern Simd_widenfun Simd_widen_rgb8_sse41;
+extern Simd_widenfun Simd_widen_rgb8_avx2;
+#endif
+
+
+/*
+ * A narrow function is the reverse: n Pnm_rgb pixels, whose samples
+ * must fit in a byte, into 3n bytes of packed samples
+ */
+typedef void Simd_narrowfun(unsigned char *dst, const struct Pnm_rgb *src,
+                            int n);
+
+
+/**********Simd_narrow_rgb8********
+ *
+ * Returns the fastest narrow function this CPU can run
+ * Inputs: none
+ * Return: the SSE4.1 version if the CPU has SSE4.1, else the scalar one
+ *
+ * Notes:
+ *      The SSE4.1 version packs four pixels' 12 samples down to 12 bytes
+ *      with two saturating packs. An AVX2 version would only add lane
+ *      fixups, since the packs work within 128 bit lanes
+ *
+ ************************/
+Simd_narrowfun *Simd_narrow_rgb8(void);
+
+extern Simd_narrowfun Simd_narrow_rgb8_scalar;
+#if defined(__x86_64__) || defined(__i386__)
+extern Simd_narrowfun Simd_narrow_rgb8_sse41;
+#endif
+
+#endif
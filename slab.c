@@ -0,0 +1,117 @@
+/*
+ *     slab.c
+ *
+ *     locality
+ *
+ *     This is the implementation file for our Slab interface.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "assert.h"
+#include "slab.h"
+
+/* Anything at least this big is mapped directly instead of malloc'd */
+#define MMAP_THRESHOLD (1 << 20)
+
+/* how much of a slab one prefault task touches */
+#define PREFAULT_PIECE ((size_t)2 << 20)
+
+/* the region this thread's slabs come from, if any */
+static __thread Region_T current;
+
+static Region_pages pages = REGION_PAGES;
+static bool prefault = false;
+static Threadpool_T prefault_pool = NULL;
+
+struct touching {
+        char *slab;
+        size_t nbytes;
+        size_t step;
+};
+
+/* writes a zero to every page of one piece, which faults it in */
+static void touch_piece(int task, int worker, void *cl)
+{
+        (void)worker;
+        struct touching *t = cl;
+        volatile char *slab = t->slab;
+        size_t start = (size_t)task * PREFAULT_PIECE;
+        size_t end = start + PREFAULT_PIECE < t->nbytes 
+                   ? start + PREFAULT_PIECE : t->nbytes;
+        for (size_t at = start; at < end; at += t->step) {
+                slab[at] = 0;
+        }
+}
+
+static void touch(char *slab, size_t nbytes)
+{
+        struct touching t = { slab, nbytes, 
+                              (size_t)sysconf(_SC_PAGESIZE) };
+        int pieces = (nbytes + PREFAULT_PIECE - 1) / PREFAULT_PIECE;
+        if (prefault_pool != NULL) {
+                Threadpool_run(prefault_pool, pieces, touch_piece, &t);
+                return;
+        }
+        for (int p = 0; p < pieces; p++) {
+                touch_piece(p, 0, &t);
+        }
+}
+
+void Slab_pages(Region_pages kind)
+{
+        pages = kind;
+}
+
+void Slab_prefault(bool on, Threadpool_T pool)
+{
+        prefault = on;
+        prefault_pool = pool;
+}
+
+Region_T Slab_use(Region_T region)
+{
+        Region_T previous = current;
+        current = region;
+        return previous;
+}
+
+void *Slab_alloc(size_t nbytes)
+{
+        void *slab = NULL;
+
+        if (current != NULL) {
+                size_t align = nbytes >= MMAP_THRESHOLD 
+                             ? (size_t)sysconf(_SC_PAGESIZE) : SLAB_ALIGN;
+                return Region_alloc(current, nbytes, align);
+        }
+        if (nbytes >= MMAP_THRESHOLD) {
+                /* anonymous mappings are page aligned and already zero */
+                slab = Region_map(nbytes, pages, NULL);
+                if (prefault) {
+                        touch(slab, nbytes);
+                }
+                return slab;
+        }
+
+        int rc = posix_memalign(&slab, SLAB_ALIGN, nbytes > 0 ? nbytes : 1);
+        assert(rc == 0);
+        memset(slab, 0, nbytes);
+        return slab;
+}
+
+void Slab_free(void *slab, size_t nbytes)
+{
+        if (slab == NULL || (current != NULL && 
+                             Region_owns(current, slab))) {
+                return;
+        }
+        if (nbytes >= MMAP_THRESHOLD) {
+                Region_unmap(slab, nbytes, pages);
+        } else {
+                free(slab);
+        }
+}
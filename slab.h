@@ -0,0 +1,109 @@
+/*
+ *     slab.h
+ *
+ *     locality
+ *
+ *     This is the header file for the Slab interface, which hands out the
+ *     single large allocations that back our contiguous 2D arrays, from
+ *     the heap or from a Region.
+ *
+ */
+
+#ifndef SLAB_INCLUDED
+#define SLAB_INCLUDED
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "region.h"
+#include "threadpool.h"
+
+/* Every slab starts on a cache line boundary */
+#define SLAB_ALIGN 64
+
+
+/**********Slab_alloc********
+ *
+ * Allocates one zero-filled, SLAB_ALIGN-aligned block of memory
+ * Inputs: number of bytes to allocate
+ * Return: pointer to the start of the block
+ * Expects:
+ *      nbytes to be the same value later passed to Slab_free
+ * Notes:
+ *      Large slabs come straight from mmap, so their pages are zero
+ *      without being touched; the first write to a page is what faults it
+ *      in (unless Slab_prefault is on). Their pages are the kind
+ *      Slab_pages picked. With a region in use on this thread (see
+ *      Slab_use) the block comes from the region instead, aligned to
+ *      SLAB_ALIGN, or to a page if it is large. Will throw a checked
+ *      runtime error if memory can't be allocated
+ *
+ ************************/
+void *Slab_alloc(size_t nbytes);
+
+
+/**********Slab_free********
+ *
+ * Releases a block returned by Slab_alloc
+ * Inputs: pointer to the block and its size in bytes
+ * Return: nothing
+ * Expects: nbytes to match the size passed to Slab_alloc
+ *
+ * Notes: freeing NULL does nothing. Neither does freeing a block of the
+ *      region this thread is using; the region takes it back when it is
+ *      reset or freed
+ *
+ ************************/
+void Slab_free(void *slab, size_t nbytes);
+
+
+/**********Slab_use********
+ *
+ * Makes this thread's slabs come from a region, or from the heap again
+ * Inputs: the region, or NULL
+ * Return: the region this thread was using before, or NULL
+ * Expects:
+ *      Every slab from the region to be freed (if at all) on this thread
+ *      before it stops using the region
+ * Notes:
+ *      Each thread has its own setting, so workers can each have a region
+ *
+ ************************/
+Region_T Slab_use(Region_T region);
+
+
+/**********Slab_pages********
+ *
+ * Picks the kind of pages large heap slabs are mapped with
+ * Inputs: REGION_PAGES (the default), REGION_THP or REGION_HUGETLB
+ * Return: nothing
+ * Expects: to be called before any slab is allocated, since Slab_free
+ *      unmaps a slab as the kind it was mapped as
+ * Notes:
+ *      2MB pages mean a 512th of the page faults, and far fewer dTLB
+ *      misses when a 90 or 270 scatters its writes. REGION_HUGETLB
+ *      falls back to ordinary pages when none are reserved. Slabs under
+ *      a megabyte still come from malloc
+ *
+ ************************/
+void Slab_pages(Region_pages pages);
+
+
+/**********Slab_prefault********
+ *
+ * Makes Slab_alloc fault in every page of each large heap slab before
+ * returning it
+ * Inputs: whether to, and a pool to share the pages out over (or NULL to
+ *      do it on the allocating thread)
+ * Return: nothing
+ * Expects: Slab_alloc not to be called from the pool's own tasks while it
+ *      is set
+ * Notes:
+ *      The faults are taken all at once, up front, instead of one by one
+ *      as the slab is first written. With a pool they are taken by all
+ *      the workers at once, so on NUMA machines each worker's share of
+ *      pages is placed near it
+ *
+ ************************/
+void Slab_prefault(bool on, Threadpool_T pool);
+
+#endif
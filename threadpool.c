@@ -0,0 +1,278 @@
+/*
+ *     threadpool.c
+ *
+ *     locality
+ *
+ *     This is the implementation file for our Threadpool interface.
+ *
+ *     Every worker owns a deque of task numbers. Since tasks never make
+ *     more tasks, a deque is just a range [lo, hi), kept as two 32 bit
+ *     halves of one word. The owner takes from the front and thieves cut
+ *     off the back half, each with a single compare and swap, so nobody
+ *     ever waits on a lock to get work. The mutex and condition
+ *     variables only start the workers and report that a run is over.
+ *
+ */
+
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "assert.h"
+#include "mem.h"
+#include "slab.h"
+#include "threadpool.h"
+
+#define T Threadpool_T
+
+/* one per cache line, so workers claiming tasks don't slow each other */
+struct deque {
+        uint64_t range;
+        char pad[SLAB_ALIGN - sizeof(uint64_t)];
+};
+
+struct worker {
+        T pool;
+        int id;
+};
+
+struct T {
+        int nthreads;
+        bool pin;
+        pthread_t *threads;          /* workers 1 .. nthreads - 1 */
+        struct worker *workers;
+        struct deque *deques;
+
+        pthread_mutex_t lock;
+        pthread_cond_t start;        /* a new run (or quit) was posted */
+        pthread_cond_t done;         /* the last busy worker finished */
+        unsigned long generation;    /* number of runs posted so far */
+        int busy;                    /* helpers still working on a run */
+        bool quit;
+
+        Threadpool_taskfun *task;
+        void *cl;
+};
+
+static inline uint64_t pack(uint32_t lo, uint32_t hi)
+{
+        return (uint64_t)lo << 32 | hi;
+}
+
+/* takes the first task in d, if there is one */
+static bool pop(struct deque *d, int *task)
+{
+        uint64_t range = __atomic_load_n(&d->range, __ATOMIC_ACQUIRE);
+        for (;;) {
+                uint32_t lo = range >> 32;
+                uint32_t hi = (uint32_t)range;
+                if (lo >= hi) {
+                        return false;
+                }
+                if (__atomic_compare_exchange_n(&d->range, &range,
+                                                pack(lo + 1, hi), false,
+                                                __ATOMIC_ACQ_REL,
+                                                __ATOMIC_ACQUIRE)) {
+                        *task = lo;
+                        return true;
+                }
+        }
+}
+
+/* cuts the back half (rounded up) off d and returns it in *lop, *hip */
+static bool steal_half(struct deque *d, uint32_t *lop, uint32_t *hip)
+{
+        uint64_t range = __atomic_load_n(&d->range, __ATOMIC_ACQUIRE);
+        for (;;) {
+                uint32_t lo = range >> 32;
+                uint32_t hi = (uint32_t)range;
+                if (lo >= hi) {
+                        return false;
+                }
+                uint32_t mid = lo + (hi - lo) / 2;
+                if (__atomic_compare_exchange_n(&d->range, &range,
+                                                pack(lo, mid), false,
+                                                __ATOMIC_ACQ_REL,
+                                                __ATOMIC_ACQUIRE)) {
+                        *lop = mid;
+                        *hip = hi;
+                        return true;
+                }
+        }
+}
+
+/*
+ * Refills worker id's (empty) deque from the first other worker that
+ * still has tasks. Nobody else pushes onto an empty deque, so a plain
+ * store is enough to publish what was stolen
+ */
+static bool steal(T pool, int id)
+{
+        for (int k = 1; k < pool->nthreads; k++) {
+                int victim = (id + k) % pool->nthreads;
+                uint32_t lo, hi;
+                if (steal_half(&pool->deques[victim], &lo, &hi)) {
+                        __atomic_store_n(&pool->deques[id].range,
+                                         pack(lo, hi), __ATOMIC_RELEASE);
+                        return true;
+                }
+        }
+        return false;
+}
+
+/*
+ * Tasks never make tasks, so once every deque has looked empty the only
+ * work left is work some thief already holds, and it will do it
+ */
+static void work(T pool, int id)
+{
+        int task;
+        do {
+                while (pop(&pool->deques[id], &task)) {
+                        pool->task(task, id, pool->cl);
+                }
+        } while (steal(pool, id));
+}
+
+static void pin(int id)
+{
+        long ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(id % (ncpus > 0 ? ncpus : 1), &set);
+        /* pinning is only a hint; carry on unpinned if it is refused */
+        (void)pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+static void *worker_main(void *arg)
+{
+        struct worker *self = arg;
+        T pool = self->pool;
+        unsigned long seen = 0;
+
+        if (pool->pin) {
+                pin(self->id);
+        }
+        pthread_mutex_lock(&pool->lock);
+        for (;;) {
+                while (pool->generation == seen && !pool->quit) {
+                        pthread_cond_wait(&pool->start, &pool->lock);
+                }
+                if (pool->quit) {
+                        break;
+                }
+                seen = pool->generation;
+                pthread_mutex_unlock(&pool->lock);
+
+                work(pool, self->id);
+
+                pthread_mutex_lock(&pool->lock);
+                if (--pool->busy == 0) {
+                        pthread_cond_signal(&pool->done);
+                }
+        }
+        pthread_mutex_unlock(&pool->lock);
+        return NULL;
+}
+
+T Threadpool_new(int nthreads, bool pin_workers)
+{
+        if (nthreads <= 0) {
+                long ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+                nthreads = ncpus > 0 ? ncpus : 1;
+        }
+
+        T pool;
+        NEW(pool);
+        pool->nthreads   = nthreads;
+        pool->pin        = pin_workers;
+        pool->generation = 0;
+        pool->busy       = 0;
+        pool->quit       = false;
+        pool->task       = NULL;
+        pool->cl         = NULL;
+        pool->deques     = Slab_alloc(nthreads * sizeof(struct deque));
+        pool->workers    = ALLOC(nthreads * sizeof(struct worker));
+        pool->threads    = ALLOC(nthreads * sizeof(pthread_t));
+        pthread_mutex_init(&pool->lock, NULL);
+        pthread_cond_init(&pool->start, NULL);
+        pthread_cond_init(&pool->done, NULL);
+
+        if (pin_workers) {
+                pin(0);
+        }
+        for (int i = 0; i < nthreads; i++) {
+                pool->workers[i].pool = pool;
+                pool->workers[i].id = i;
+                if (i > 0) {
+                        int rc = pthread_create(&pool->threads[i], NULL,
+                                                worker_main,
+                                                &pool->workers[i]);
+                        assert(rc == 0);
+                }
+        }
+        return pool;
+}
+
+void Threadpool_free(T *pool)
+{
+        assert(pool != NULL && *pool != NULL);
+        T p = *pool;
+
+        pthread_mutex_lock(&p->lock);
+        p->quit = true;
+        pthread_cond_broadcast(&p->start);
+        pthread_mutex_unlock(&p->lock);
+        for (int i = 1; i < p->nthreads; i++) {
+                pthread_join(p->threads[i], NULL);
+        }
+
+        pthread_cond_destroy(&p->done);
+        pthread_cond_destroy(&p->start);
+        pthread_mutex_destroy(&p->lock);
+        Slab_free(p->deques, p->nthreads * sizeof(struct deque));
+        FREE(p->workers);
+        FREE(p->threads);
+        FREE(*pool);
+}
+
+int Threadpool_size(T pool)
+{
+        assert(pool != NULL);
+        return pool->nthreads;
+}
+
+void Threadpool_run(T pool, int ntasks, Threadpool_taskfun *task, void *cl)
+{
+        assert(pool != NULL && task != NULL && ntasks >= 0);
+        int n = pool->nthreads;
+
+        for (int i = 0; i < n; i++) {
+                pool->deques[i].range = pack((long)ntasks * i / n,
+                                             (long)ntasks * (i + 1) / n);
+        }
+        pool->task = task;
+        pool->cl = cl;
+        if (n == 1) {
+                work(pool, 0);
+                return;
+        }
+
+        /* the unlock publishes the deques and the task to the helpers */
+        pthread_mutex_lock(&pool->lock);
+        pool->busy = n - 1;
+        pool->generation++;
+        pthread_cond_broadcast(&pool->start);
+        pthread_mutex_unlock(&pool->lock);
+
+        work(pool, 0);
+
+        pthread_mutex_lock(&pool->lock);
+        while (pool->busy > 0) {
+                pthread_cond_wait(&pool->done, &pool->lock);
+        }
+        pthread_mutex_unlock(&pool->lock);
+}
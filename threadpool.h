@@ -0,0 +1,76 @@
+/*
+ *     threadpool.h
+ *
+ *     locality
+ *
+ *     This is the header file for the Threadpool interface, a fixed set
+ *     of worker threads that share out numbered tasks by work stealing.
+ *
+ */
+
+#ifndef THREADPOOL_INCLUDED
+#define THREADPOOL_INCLUDED
+
+#include <stdbool.h>
+
+#define T Threadpool_T
+typedef struct T *T;
+
+/* runs task number task on worker number worker (0 .. size - 1) */
+typedef void Threadpool_taskfun(int task, int worker, void *cl);
+
+
+/**********Threadpool_new********
+ *
+ * Starts a pool of worker threads
+ * Inputs: number of workers, and whether to pin each worker to a CPU
+ * Return: the new pool
+ * Expects: nothing
+ * Notes:
+ *      nthreads <= 0 means one worker per online CPU. The thread that
+ *      calls Threadpool_run counts as worker 0, so nthreads - 1 threads
+ *      are created. With pin set, worker i (the caller included) is
+ *      bound to CPU i modulo the number of CPUs
+ *
+ ************************/
+T Threadpool_new(int nthreads, bool pin);
+
+
+/**********Threadpool_free********
+ *
+ * Stops and joins the workers, and frees the pool
+ * Inputs: pointer to a pool
+ * Return: nothing
+ * Expects: pool to be nonnull and not running anything
+ *
+ ************************/
+void Threadpool_free(T *pool);
+
+
+/**********Threadpool_size********
+ *
+ * Returns the number of workers, the calling thread included
+ *
+ ************************/
+int Threadpool_size(T pool);
+
+
+/**********Threadpool_run********
+ *
+ * Runs task(0, ...) through task(ntasks - 1, ...) on the pool's workers
+ * and returns once every one of them is done
+ * Inputs: the pool, number of tasks, the task function and a closure
+ * Return: nothing
+ * Expects: ntasks >= 0, task nonnull
+ * Notes:
+ *      Each worker starts with an even, contiguous share of the task
+ *      numbers and works through it in order. A worker that runs dry
+ *      steals the back half of another worker's remaining share, so
+ *      uneven tasks still keep every worker busy. Neighbouring tasks
+ *      tend to stay on one worker, which is good for locality
+ *
+ ************************/
+void Threadpool_run(T pool, int ntasks, Threadpool_taskfun *task, void *cl);
+
+#undef T
+#endif
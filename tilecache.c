@@ -0,0 +1,227 @@
+/*
+ *     tilecache.c
+ *
+ *     locality
+ *
+ *     This is the implementation file for our TileCache interface.
+ *
+ *     Every block in memory sits in a frame, and the frames are kept on a
+ *     doubly linked list from most to least recently used. A hit moves
+ *     its frame to the front; a miss reuses the frame at the back.
+ *
+ */
+
+#include <stdbool.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include "assert.h"
+#include "mem.h"
+#include "slab.h"
+#include "tilecache.h"
+
+#define T TileCache_T
+
+const Except_T TileCache_Failed = { "Tile cache file I/O failed" };
+
+struct frame {
+        int block;              /* by * blockswide + bx, or -1 if empty */
+        bool dirty;
+        int newer;              /* neighbours on the list, -1 at the ends */
+        int older;
+};
+
+struct T {
+        int fd;
+        struct UArray2b_T layout;
+        size_t framebytes;      /* one full blocksize x blocksize block */
+        int nframes;
+        char *bytes;            /* the frames' blocks, back to back */
+        struct frame *frames;
+        int newest;
+        int oldest;
+        int *where;             /* each block's frame, or -1 */
+        bool *stored;           /* whether each block was ever written */
+        unsigned long misses;
+};
+
+static inline int block_bx(T cache, int block)
+{
+        return block % cache->layout.blockswide;
+}
+
+static inline int block_by(T cache, int block)
+{
+        return block / cache->layout.blockswide;
+}
+
+static size_t block_bytes(T cache, int block)
+{
+        UArray2b_T a = &cache->layout;
+        return (size_t)UArray2b_blockwidth(a, block_bx(cache, block)) *
+               UArray2b_blockheight(a, block_by(cache, block)) * a->size;
+}
+
+static off_t block_offset(T cache, int block)
+{
+        UArray2b_T a = &cache->layout;
+        return (off_t)UArray2b_blockstart(a, block_bx(cache, block),
+                                          block_by(cache, block)) * a->size;
+}
+
+/* all n bytes, in as many preads or pwrites as it takes */
+static void transfer(int fd, char *buf, size_t n, off_t offset, bool out)
+{
+        while (n > 0) {
+                ssize_t done = out ? pwrite(fd, buf, n, offset)
+                                   : pread(fd, buf, n, offset);
+                if (done < 0 && errno == EINTR) {
+                        continue;
+                }
+                if (done <= 0) {
+                        RAISE(TileCache_Failed);
+                }
+                buf += done;
+                n -= done;
+                offset += done;
+        }
+}
+
+static void write_back(T cache, int f)
+{
+        struct frame *frame = &cache->frames[f];
+        if (frame->block >= 0 && frame->dirty) {
+                transfer(cache->fd, cache->bytes + f * cache->framebytes,
+                         block_bytes(cache, frame->block),
+                         block_offset(cache, frame->block), true);
+                cache->stored[frame->block] = true;
+        }
+        frame->dirty = false;
+}
+
+static void unlink_frame(T cache, int f)
+{
+        struct frame *frame = &cache->frames[f];
+        if (frame->newer >= 0) {
+                cache->frames[frame->newer].older = frame->older;
+        } else {
+                cache->newest = frame->older;
+        }
+        if (frame->older >= 0) {
+                cache->frames[frame->older].newer = frame->newer;
+        } else {
+                cache->oldest = frame->newer;
+        }
+}
+
+static void push_newest(T cache, int f)
+{
+        struct frame *frame = &cache->frames[f];
+        frame->newer = -1;
+        frame->older = cache->newest;
+        if (cache->newest >= 0) {
+                cache->frames[cache->newest].newer = f;
+        } else {
+                cache->oldest = f;
+        }
+        cache->newest = f;
+}
+
+T TileCache_new(int fd, UArray2b_T layout, size_t budget)
+{
+        assert(fd >= 0 && layout != NULL);
+        T cache;
+        NEW(cache);
+        cache->fd = fd;
+        cache->layout = *layout;
+        cache->framebytes = (size_t)layout->blocksize * layout->blocksize *
+                            layout->size;
+
+        int nblocks = layout->blockswide * layout->blockshigh;
+        size_t nframes = budget / cache->framebytes;
+        nframes = nframes < 1 ? 1 : nframes;
+        cache->nframes = nframes < (size_t)nblocks ? (int)nframes : nblocks;
+
+        cache->bytes = Slab_alloc(cache->nframes * cache->framebytes);
+        cache->frames = ALLOC(cache->nframes * sizeof(struct frame));
+        cache->newest = cache->oldest = -1;
+        for (int f = 0; f < cache->nframes; f++) {
+                cache->frames[f].block = -1;
+                cache->frames[f].dirty = false;
+                push_newest(cache, f);
+        }
+
+        cache->where = ALLOC(nblocks * sizeof(int));
+        cache->stored = ALLOC(nblocks * sizeof(bool));
+        for (int b = 0; b < nblocks; b++) {
+                cache->where[b] = -1;
+                cache->stored[b] = false;
+        }
+        cache->misses = 0;
+        return cache;
+}
+
+void TileCache_free(T *cache)
+{
+        assert(cache != NULL && *cache != NULL);
+        T c = *cache;
+        TileCache_flush(c);
+        Slab_free(c->bytes, c->nframes * c->framebytes);
+        FREE(c->frames);
+        FREE(c->where);
+        FREE(c->stored);
+        FREE(*cache);
+}
+
+char *TileCache_block(T cache, int bx, int by)
+{
+        assert(cache != NULL);
+        assert(bx >= 0 && bx < cache->layout.blockswide);
+        assert(by >= 0 && by < cache->layout.blockshigh);
+        int block = by * cache->layout.blockswide + bx;
+        int f = cache->where[block];
+
+        if (f < 0) {
+                f = cache->oldest;
+                struct frame *frame = &cache->frames[f];
+                write_back(cache, f);
+                if (frame->block >= 0) {
+                        cache->where[frame->block] = -1;
+                }
+                frame->block = block;
+                cache->where[block] = f;
+                if (cache->stored[block]) {
+                        transfer(cache->fd,
+                                 cache->bytes + f * cache->framebytes,
+                                 block_bytes(cache, block),
+                                 block_offset(cache, block), false);
+                }
+                cache->misses++;
+        }
+        if (f != cache->newest) {
+                unlink_frame(cache, f);
+                push_newest(cache, f);
+        }
+        cache->frames[f].dirty = true;
+        return cache->bytes + f * cache->framebytes;
+}
+
+void TileCache_flush(T cache)
+{
+        assert(cache != NULL);
+        for (int f = 0; f < cache->nframes; f++) {
+                write_back(cache, f);
+        }
+}
+
+unsigned long TileCache_misses(T cache)
+{
+        assert(cache != NULL);
+        return cache->misses;
+}
+
+void TileCache_transfer(int fd, void *buf, size_t n, off_t offset, bool out)
+{
+        assert(buf != NULL || n == 0);
+        transfer(fd, buf, n, offset, out);
+}
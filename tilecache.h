@@ -0,0 +1,116 @@
+/*
+ *     tilecache.h
+ *
+ *     locality
+ *
+ *     This is the header file for the TileCache interface, a write-back
+ *     cache of the blocks of a UArray2b that lives in a file rather than
+ *     in memory. The file is laid out exactly as UArray2b lays out its
+ *     slab, so a block is both the unit of caching and the unit of I/O.
+ *
+ */
+
+#ifndef TILECACHE_INCLUDED
+#define TILECACHE_INCLUDED
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+#include "except.h"
+#include "uarray2b_impl.h"
+
+#define T TileCache_T
+typedef struct T *T;
+
+/* raised when the backing file can't be read or written */
+extern const Except_T TileCache_Failed;
+
+
+/**********TileCache_new********
+ *
+ * Makes a cache of the blocks of a file
+ * Inputs: the file descriptor, the layout of the array the file holds
+ *      (see UArray2b_layout), and how many bytes of blocks to keep in
+ *      memory
+ * Return: the new cache
+ * Expects: fd open for reading and writing, layout nonnull
+ * Notes:
+ *      Block (bx, by) is the bytes of the file starting at
+ *      UArray2b_blockstart(layout, bx, by) * layout->size. The cache holds
+ *      budget / (blocksize * blocksize * size) blocks, but always at
+ *      least one. The file is not read or written until blocks are
+ *
+ ************************/
+T TileCache_new(int fd, UArray2b_T layout, size_t budget);
+
+
+/**********TileCache_free********
+ *
+ * Writes back every dirty block and frees the cache
+ * Inputs: pointer to a cache
+ * Return: nothing
+ * Expects: cache to be nonnull
+ *
+ ************************/
+void TileCache_free(T *cache);
+
+
+/**********TileCache_block********
+ *
+ * Returns the bytes of block (bx, by), to be written
+ * Inputs: the cache and the block's column and row of blocks
+ * Return: the block's elements, stored row major with a row of
+ *      UArray2b_blockwidth(layout, bx) elements
+ * Expects: bx and by within the layout
+ * Notes:
+ *      The block is marked dirty and most recently used. If it isn't in
+ *      memory, the least recently used block is written back (if dirty)
+ *      to make room, and the block is read back in if it was ever
+ *      written back before. A block that never was is not read at all,
+ *      so its contents are garbage until they are written. The pointer
+ *      is only good until the next TileCache_block call, which may
+ *      evict it. Raises TileCache_Failed if the file can't be read or
+ *      written
+ *
+ ************************/
+char *TileCache_block(T cache, int bx, int by);
+
+
+/**********TileCache_flush********
+ *
+ * Writes back every dirty block, so the file holds the whole array
+ * Inputs: the cache
+ * Return: nothing
+ * Notes:
+ *      Blocks stay in memory, clean. Raises TileCache_Failed if the file
+ *      can't be written
+ *
+ ************************/
+void TileCache_flush(T cache);
+
+
+/**********TileCache_misses********
+ *
+ * Returns how many TileCache_block calls had to load their block
+ * (or set it up, if it had never been written back)
+ *
+ ************************/
+unsigned long TileCache_misses(T cache);
+
+
+/**********TileCache_transfer********
+ *
+ * Reads (or, with out set, writes) exactly n bytes of a file at offset,
+ * the way the cache moves its blocks
+ * Inputs: the file descriptor, the buffer, the byte count and offset,
+ *      and which way to go
+ * Return: nothing
+ * Notes:
+ *      Short transfers are continued and EINTR is retried. Raises
+ *      TileCache_Failed on any other error, or at end of file
+ *
+ ************************/
+void TileCache_transfer(int fd, void *buf, size_t n, off_t offset, bool out);
+
+#undef T
+#endif
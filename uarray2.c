@@ -68,6 +68,16 @@ void *UArray2_at(T array2, int i, int j)
         assert(array2 != NULL);
         return UArray_at(row(array2, j), i);
 }
+
+void *UArray2_row(T array2, int j, int *length)
+{
+        assert(array2 != NULL && length != NULL);
+        assert(j >= 0 && j < array2->height);
+        *length = array2->width;
+        if (array2->width == 0)
+                return NULL;  /* UArray_at has no element 0 to give */
+        return UArray_at(row(array2, j), 0);
+}
 #line 162 "www/solutions/uarray2.nw"
 int UArray2_height(T array2)
 {
@@ -111,7 +121,42 @@ void UArray2_map_col_major(T array2,
         assert(array2 != NULL);
         int h = array2->height;  /* keeping height and width in registers */
         int w = array2->width;   /* avoids extra memory traffic           */
-        for (int i = 0; i < w; i++)
+        int size = array2->size;
+        if (w == 0 || h == 0)
+                return;
+
+        /*
+         * Going down a column through row() and UArray_at touches every
+         * row's UArray header for each element. Instead each row's start
+         * is looked up once, into a buffer of row pointers, and element
+         * (i, j) is rows[j] + i * size. This saves the per-element calls
+         * and header loads only: the client wants exact column-major
+         * order, so the walk down each column still strides from row to
+         * row and reuses a cache line only if it survives a whole column.
+         */
+        char **rows = ALLOC(h * (long)sizeof(*rows));
+        for (int j = 0; j < h; j++)
+                rows[j] = UArray_at(row(array2, j), 0);
+
+        for (int i = 0; i < w; i++) {
+                size_t offset = (size_t)i * size;
                 for (int j = 0; j < h; j++)
-                        apply(i, j, array2, UArray_at(row(array2, j), i), cl);
+                        apply(i, j, array2, rows[j] + offset, cl);
+        }
+        FREE(rows);
+}
+
+void UArray2_map_region(T array2, int x, int y, int w, int h,
+                        void apply(int i, int j, T array2, 
+                                   void *elem, void *cl), 
+                        void *cl)
+{
+        assert(array2 != NULL);
+        assert(x >= 0 && y >= 0 && w >= 0 && h >= 0);
+        assert(x + w <= array2->width && y + h <= array2->height);
+        for (int j = 0; j < h; j++) {
+                UArray_T thisrow = row(array2, y + j);
+                for (int i = 0; i < w; i++)
+                        apply(i, j, array2, UArray_at(thisrow, x + i), cl);
+        }
 }
\ No newline at end of file
@@ -51,6 +51,23 @@ typedef struct UArray2_T *UArray2_T;
 void *UArray2_at(UArray2_T UArray2, int col, int row);
 
 
+/**********UArray2_row********
+ *
+ * Finds a whole row of a UArray2, which lies contiguous in memory
+ * Inputs: The UArray2, the row, and where to put the row's length
+ * Return: A pointer to the element in column 0 of the row; *length is set
+ *      to the number of elements in it (the width). If the width is 0
+ *      there is no such element, so the pointer is NULL and *length is 0
+ * Expects
+ *      The row to be between 0 and the height of the UArray2 - 1
+ *              A nonnull UArray2 and length
+ *
+ * Notes: Element col of the row is col * UArray2_size bytes from the start
+ *
+ ************************/
+void *UArray2_row(UArray2_T UArray2, int row, int *length);
+
+
 /**********UArray2_size********
  *
  * Returns the number of bytes used to store one element in UArray2
@@ -124,6 +141,26 @@ void UArray2_map_col_major(UArray2_T UArray2, void apply(int col, int row,
                         UArray2_T UArray2, void *curr, void *cl), void *cl);
 
 
+/**********UArray2_map_region********
+ *
+ * Applies a function onto the elements of a rectangle of a UArray2 one by
+ * one in order of row major
+ * Inputs: The UArray2, the col and row of the rectangle's top left
+ *      element, its width and height, the function to apply, and its
+ *      closure
+ * Return: nothing
+ * Expects: 
+ *      Nonnull UArray2
+ *              A rectangle that lies inside the UArray2
+ * Notes: apply gets each element's col/row relative to the rectangle, so
+ *      its top left element is (0, 0)
+ *
+ ************************/
+void UArray2_map_region(UArray2_T UArray2, int col, int row, int width, 
+                        int height, void apply(int col, int row, 
+                        UArray2_T UArray2, void *curr, void *cl), void *cl);
+
+
 /**********UArray2_free********
  *
  * Frees up all space allocated by a UArray 2
@@ -9,99 +9,87 @@
  *
  */
 
-#include "uarray2b.h"
-#include "uarray2.h"
+#include "uarray2b_impl.h"
+#include "slab.h"
+#include "cacheinfo.h"
 #include <stdio.h>
 #include <stdlib.h>
-#include <math.h>
 #include <assert.h>
 
 #define T UArray2b_T
 
-struct T {
-        int width; 
-        int height; 
-        int size; 
-        int blocksize;
-        int totalblocks;
-        UArray2_T elems;
-};
+/* returns log2(n) if n is a power of two, -1 otherwise */
+static int log2_exact(int n)
+{
+        int shift = 0;
+        if (n <= 0 || (n & (n - 1)) != 0) {
+                return -1;
+        }
+        while ((1 << shift) != n) {
+                shift++;
+        }
+        return shift;
+}
 
-extern T UArray2b_new (int width, int height, int size, int blocksize)
+static inline size_t slab_bytes(T array2b)
+{
+        return (size_t)array2b->width * array2b->height * array2b->size;
+}
+
+struct T UArray2b_layout(int width, int height, int size, int blocksize)
 {
         assert(blocksize > 0);
         assert(width > 0);
         assert(height > 0);
 
-        T toReturn = malloc(sizeof(struct T));
-        toReturn->width = width;
-        toReturn->height = height;
-        toReturn->size = size;
-        toReturn->blocksize = blocksize;
+        struct T layout;
+        layout.width = width;
+        layout.height = height;
+        layout.size = size;
+        layout.blocksize = blocksize;
 
         /* ceiling to get upper bound of how many blocks we need */
-        int blockwidth = ceil((float)width / blocksize);
-        int blockheight = ceil((float)height / blocksize);
-        int totalblocks = (blockheight * blockwidth);
-        
-        UArray2_T blocks = UArray2_new(blockwidth, blockheight, 
-                (sizeof(UArray2_T)));
-        
-        int col, row;
-
-        /* Initializing the blocks (UArray2s) that store elements */
-        for (int i = 0; i < totalblocks; i++) {
-                row = i / blockwidth;
-                if (row == 0) {
-                        col = i;
-                        
-                } else {
-                        col = (i % blockwidth);
-                }
-                                
-                UArray2_T curr = UArray2_new(blocksize, blocksize, size);
-                *(UArray2_T *)UArray2_at(blocks, col, row) = curr;
-        }
+        layout.blockswide = (width + blocksize - 1) / blocksize;
+        layout.blockshigh = (height + blocksize - 1) / blocksize;
+        layout.lastwidth = width - (layout.blockswide - 1) * blocksize;
+        layout.lastheight = height - (layout.blockshigh - 1) * blocksize;
+
+        layout.shift = log2_exact(blocksize);
+        layout.mask = blocksize - 1;
+        layout.elems = NULL;
+        return layout;
+}
 
-        toReturn->totalblocks = totalblocks;
-        toReturn->elems = blocks;
+extern T UArray2b_new (int width, int height, int size, int blocksize)
+{
+        T toReturn = malloc(sizeof(struct T));
+        assert(toReturn != NULL);
+        *toReturn = UArray2b_layout(width, height, size, blocksize);
+        toReturn->elems = Slab_alloc(slab_bytes(toReturn));
 
         return toReturn;
 }
 
+/*
+ * Despite the name, blocks are sized for a real cache on this machine
+ * (L2 unless CacheInfo_set_default_level says otherwise). A 64KB-element
+ * block of Pnm_rgb pixels is 64MB, which fits in no cache at all.
+ */
 extern T UArray2b_new_64K_block(int width, int height, int size)
 {
         assert(width > 0);
         assert(height > 0);
-        int blocktotal = (64000*1024)/size;
-        int maxsize = sqrt(blocktotal);
-        T toreturn = UArray2b_new(width, height, size, maxsize);
+        int blocksize = CacheInfo_blocksize(CacheInfo_default_level(), size);
+        T toreturn = UArray2b_new(width, height, size, blocksize);
         return toreturn;
 }
 
 extern void UArray2b_free (T *array2b) 
 {
         assert(array2b && *array2b);
-        int col, row;
-        int width = UArray2b_width(*array2b);
-        int blocksize = UArray2b_blocksize(*array2b);
-        int blockwidth = ceil((float)width / blocksize);
-        int size = (*array2b)->totalblocks;
-
-        /* free each block (UArray2) */ 
-        for (int i = 0; i < size; i++) {
-                row  = i / blockwidth;
-                if (row == 0) {
-                        col = i;
-                } else {
-                        col = (i % blockwidth);
-                }
-                UArray2_free((UArray2_T*) UArray2_at(((*array2b)->elems), 
-                                                                col, row));
-        }
-
-        UArray2_free(&(*array2b)->elems);
+        Slab_free((*array2b)->elems, slab_bytes(*array2b));
         free (*array2b);
+        *array2b = NULL;
 }
 
 extern int UArray2b_width (T  array2b)
@@ -137,16 +125,61 @@ extern void *UArray2b_at (T array2b, int column, int row)
         assert(column >= 0 && column < width);
         assert(row >= 0 && row < height);
 
-        int blocksize = array2b->blocksize;
+        return UArray2b_addr(array2b, column, row);
+}
 
-        /* Find block */
-        UArray2_T *currBlock = (UArray2_T*) UArray2_at((array2b->elems),
-                                (column / blocksize), (row / blocksize));
-        
-        /* Find index within block */
-        void *currVal = UArray2_at(*currBlock, (column % blocksize), 
-                                                        (row % blocksize));
-        return currVal;
+void *UArray2b_block(T array2b, int bx, int by, int *stride, int *width,
+                     int *height)
+{
+        assert(array2b != NULL);
+        assert(stride != NULL && width != NULL && height != NULL);
+        assert(bx >= 0 && bx < array2b->blockswide);
+        assert(by >= 0 && by < array2b->blockshigh);
+
+        *width = UArray2b_blockwidth(array2b, bx);
+        *height = UArray2b_blockheight(array2b, by);
+        *stride = *width * array2b->size;
+        return array2b->elems 
+             + UArray2b_blockstart(array2b, bx, by) * array2b->size;
+}
+
+void UArray2b_map_region(T array2b, int x, int y, int w, int h,
+                         void apply(int col, int row, T array2b, void *elem,
+                                    void *cl),
+                         void *cl)
+{
+        assert(array2b != NULL);
+        assert(apply != NULL);
+        assert(x >= 0 && y >= 0 && w >= 0 && h >= 0);
+        assert(x + w <= array2b->width && y + h <= array2b->height);
+        if (w == 0 || h == 0) {
+                return;
+        }
+        int blocksize = array2b->blocksize;
+        int size = array2b->size;
+
+        for (int by = UArray2b_blockof(array2b, y); 
+             by <= UArray2b_blockof(array2b, y + h - 1); by++) {
+                int top = by * blocksize;
+                int row0 = top > y ? top : y;
+                int row1 = top + UArray2b_blockheight(array2b, by);
+                row1 = row1 < y + h ? row1 : y + h;
+                for (int bx = UArray2b_blockof(array2b, x);
+                     bx <= UArray2b_blockof(array2b, x + w - 1); bx++) {
+                        int left = bx * blocksize;
+                        int col0 = left > x ? left : x;
+                        int col1 = left + UArray2b_blockwidth(array2b, bx);
+                        col1 = col1 < x + w ? col1 : x + w;
+                        for (int r = row0; r < row1; r++) {
+                                char *curr = UArray2b_addr(array2b, col0, r);
+                                for (int c = col0; c < col1; c++) {
+                                        apply(c - x, r - y, array2b, curr,
+                                              cl);
+                                        curr += size;
+                                }
+                        }
+                }
+        }
 }
 
 extern void UArray2b_map (T array2b,
@@ -157,44 +190,25 @@ extern void UArray2b_map (T array2b,
         assert(array2b != NULL);
         assert(apply != NULL);
         int blocksize = array2b->blocksize;
-        int blockRow, blockCol, cellRow, cellCol, overallRow, overallCol;
-
-        int width = UArray2b_width(array2b);
-        int height = UArray2b_height(array2b);
-        int numblocks = ceil((float)width / blocksize);
-        int size = array2b->totalblocks;
-
-        /* find block to map into */
-        for (int i = 0; i < size; i++) {
-                blockRow  = i / numblocks;
-                if (blockRow == 0) {
-                        blockCol = i;
-                } else {
-                        blockCol = (i % numblocks);
-                }
-
-                UArray2_T currBlock = *(UArray2_T*) UArray2_at(
-                                (array2b->elems), blockCol, blockRow);
-
-                int blockwidth = UArray2_width(currBlock);
-
-                /* find index of block to map into */
-                for (int i = 0; i < (blocksize * blocksize); i++) {
-                        cellRow = i / blockwidth;
-                        if (cellRow == 0) {
-                                cellCol = i;
-                        } else {
-                                cellCol = (i % blockwidth);
-                        }
-                        overallRow = (blockRow * blocksize) + cellRow;
-                        overallCol = (blockCol * blocksize) + cellCol;
-                        
-                        if (overallRow < height && overallCol < width) {
-        
-                                void *curr = UArray2_at(currBlock, 
-                                                        cellCol, cellRow);
-                                apply(overallCol, overallRow, 
-                                                array2b, curr, cl);
+        int size = array2b->size;
+
+        /* blocks are stored in the order we visit them, so this is one
+           sequential sweep through the slab */
+        char *curr = array2b->elems;
+        for (int by = 0; by < array2b->blockshigh; by++) {
+                int cellheight = UArray2b_blockheight(array2b, by);
+                int top = by * blocksize;
+                for (int bx = 0; bx < array2b->blockswide; bx++) {
+                        int cellwidth = UArray2b_blockwidth(array2b, bx);
+                        int left = bx * blocksize;
+                        for (int cellRow = 0; cellRow < cellheight; 
+                                                        cellRow++) {
+                                for (int cellCol = 0; cellCol < cellwidth;
+                                                        cellCol++) {
+                                        apply(left + cellCol, top + cellRow,
+                                              array2b, curr, cl);
+                                        curr += size;
+                                }
                         }
                 }
         }
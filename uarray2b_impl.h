@@ -0,0 +1,114 @@
+/*
+ *     uarray2b_impl.h
+ *
+ *     locality
+ *
+ *     The representation of a UArray2b, for the modules (like the
+ *     ppmtrans kernels) that walk its blocks directly instead of going
+ *     through UArray2b_at.
+ *
+ */
+
+#ifndef UARRAY2B_IMPL_INCLUDED
+#define UARRAY2B_IMPL_INCLUDED
+
+#include <stddef.h>
+#include "uarray2b.h"
+
+/*
+ * All of the blocks live back to back in one slab, in the same order
+ * UArray2b_map visits them: a row of blocks at a time, left to right.
+ * Blocks on the right and bottom edges are clipped to the part that lies
+ * inside the array, so the slab holds exactly width * height elements and
+ * each band of blocks covers exactly blocksize * width of them.
+ *
+ * Block (bx, by) is blockwidth(bx) x blockheight(by) elements, starts
+ * (by * blocksize * width) + (bx * blocksize * blockheight(by)) elements
+ * into the slab, and is stored row major inside.
+ */
+struct UArray2b_T {
+        int width; 
+        int height; 
+        int size; 
+        int blocksize;
+        int blockswide;  /* number of blocks across / down */
+        int blockshigh;
+        int lastwidth;   /* extent of the clipped right / bottom blocks */
+        int lastheight;
+        int shift;       /* log2(blocksize), or -1 if not a power of two */
+        int mask;        /* blocksize - 1 when shift >= 0 */
+        char *elems;
+};
+
+/*
+ * The layout of a width x height array of size byte elements in blocks of
+ * blocksize, with elems NULL. UArray2b_new fills in elems; the out-of-core
+ * transform (outofcore.c) uses the same layout for a file instead
+ */
+struct UArray2b_T UArray2b_layout(int width, int height, int size,
+                                  int blocksize);
+
+/*
+ * Block (bx, by) as a tile: returns the address of its top left element
+ * and sets *stride to the bytes from one of its rows to the next, and
+ * *width and *height to its extent, clipped at the array's edges. Each
+ * row of the tile is contiguous. (Lives here rather than in uarray2b.h,
+ * which is the course's interface)
+ */
+void *UArray2b_block(UArray2b_T array2b, int bx, int by, int *stride,
+                     int *width, int *height);
+
+/*
+ * UArray2b_map restricted to the w x h rectangle whose top left element
+ * is (x, y): the blocks it overlaps are visited in the usual order, each
+ * clipped to the rectangle. apply gets coordinates relative to the
+ * rectangle
+ */
+void UArray2b_map_region(UArray2b_T array2b, int x, int y, int w, int h,
+                         void apply(int col, int row, UArray2b_T array2b,
+                                    void *elem, void *cl),
+                         void *cl);
+
+static inline int UArray2b_blockwidth(UArray2b_T a, int bx)
+{
+        return bx == a->blockswide - 1 ? a->lastwidth : a->blocksize;
+}
+
+static inline int UArray2b_blockheight(UArray2b_T a, int by)
+{
+        return by == a->blockshigh - 1 ? a->lastheight : a->blocksize;
+}
+
+/* block number of column (or row) n, and n's offset within that block.
+   Power of two blocks (which is every block size CacheInfo picks) avoid
+   integer division entirely */
+static inline int UArray2b_blockof(UArray2b_T a, int n)
+{
+        return a->shift >= 0 ? n >> a->shift : n / a->blocksize;
+}
+
+static inline int UArray2b_cellof(UArray2b_T a, int n)
+{
+        return a->shift >= 0 ? n & a->mask : n % a->blocksize;
+}
+
+/* offset, in elements, of the first element of block (bx, by) */
+static inline size_t UArray2b_blockstart(UArray2b_T a, int bx, int by)
+{
+        return (size_t)by * a->blocksize * a->width
+             + (size_t)bx * a->blocksize * UArray2b_blockheight(a, by);
+}
+
+/* address of element (i, j), with no bounds checks */
+static inline char *UArray2b_addr(UArray2b_T a, int i, int j)
+{
+        int bx = UArray2b_blockof(a, i);
+        int by = UArray2b_blockof(a, j);
+        size_t offset = UArray2b_blockstart(a, bx, by)
+                      + (size_t)UArray2b_cellof(a, j) 
+                                * UArray2b_blockwidth(a, bx)
+                      + UArray2b_cellof(a, i);
+        return a->elems + offset * a->size;
+}
+
+#endif
@@ -0,0 +1,132 @@
+/*
+ *     uarray2f.c
+ *
+ *     locality
+ *
+ *     This is the implementation file for our UArray2f interface.
+ *
+ */
+
+#include <stdlib.h>
+#include <stddef.h>
+
+#include "assert.h"
+#include "mem.h"
+#include "slab.h"
+#include "uarray2f_impl.h"
+
+#define T UArray2f_T
+
+static inline size_t slab_bytes(T a)
+{
+        return (size_t)a->stride * a->height;
+}
+
+T UArray2f_new(int width, int height, int size)
+{
+        assert(width >= 0 && height >= 0);
+        assert(size > 0);
+        T array;
+        NEW(array);
+        array->width  = width;
+        array->height = height;
+        array->size   = size;
+        array->stride = width * size;
+        array->elems  = Slab_alloc(slab_bytes(array));
+        return array;
+}
+
+void UArray2f_free(T *array2f)
+{
+        assert(array2f != NULL && *array2f != NULL);
+        Slab_free((*array2f)->elems, slab_bytes(*array2f));
+        FREE(*array2f);
+}
+
+int UArray2f_width(T array2f)
+{
+        assert(array2f != NULL);
+        return array2f->width;
+}
+
+int UArray2f_height(T array2f)
+{
+        assert(array2f != NULL);
+        return array2f->height;
+}
+
+int UArray2f_size(T array2f)
+{
+        assert(array2f != NULL);
+        return array2f->size;
+}
+
+int UArray2f_stride(T array2f)
+{
+        assert(array2f != NULL);
+        return array2f->stride;
+}
+
+void *UArray2f_at(T array2f, int i, int j)
+{
+        assert(array2f != NULL);
+        assert(i >= 0 && i < array2f->width);
+        assert(j >= 0 && j < array2f->height);
+        return array2f->elems + (size_t)j * array2f->stride
+                              + (size_t)i * array2f->size;
+}
+
+void UArray2f_map_row_major(T array2f,
+                            void apply(int i, int j, T array2f,
+                                       void *elem, void *cl),
+                            void *cl)
+{
+        assert(array2f != NULL);
+        assert(apply != NULL);
+        int h = array2f->height;
+        int w = array2f->width;
+        int size = array2f->size;
+        char *rowp = array2f->elems;
+        for (int j = 0; j < h; j++, rowp += array2f->stride) {
+                char *p = rowp;
+                for (int i = 0; i < w; i++, p += size)
+                        apply(i, j, array2f, p, cl);
+        }
+}
+
+void UArray2f_map_region(T array2f, int x, int y, int w, int h,
+                         void apply(int i, int j, T array2f, void *elem,
+                                    void *cl), void *cl)
+{
+        assert(array2f != NULL);
+        assert(apply != NULL);
+        assert(x >= 0 && y >= 0 && w >= 0 && h >= 0);
+        assert(x + w <= array2f->width && y + h <= array2f->height);
+        int size = array2f->size;
+        char *rowp = array2f->elems + (size_t)y * array2f->stride 
+                   + (size_t)x * size;
+        for (int j = 0; j < h; j++, rowp += array2f->stride) {
+                char *p = rowp;
+                for (int i = 0; i < w; i++, p += size)
+                        apply(i, j, array2f, p, cl);
+        }
+}
+
+void UArray2f_map_col_major(T array2f,
+                            void apply(int i, int j, T array2f,
+                                       void *elem, void *cl),
+                            void *cl)
+{
+        assert(array2f != NULL);
+        assert(apply != NULL);
+        int h = array2f->height;
+        int w = array2f->width;
+        int stride = array2f->stride;
+        char *colp = array2f->elems;
+        for (int i = 0; i < w; i++, colp += array2f->size) {
+                char *p = colp;
+                for (int j = 0; j < h; j++, p += stride)
+                        apply(i, j, array2f, p, cl);
+        }
+}
+#undef T
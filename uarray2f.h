@@ -0,0 +1,119 @@
+/*
+ *     uarray2f.h
+ *
+ *     locality
+ *
+ *     This is the header file for the UArray2f interface, a flat 2D array
+ *     that keeps every element in one slab. Element (col, row) lives at
+ *     row * stride + col * size bytes from the start of the slab, so there
+ *     is no per-row object to chase on the way to an element.
+ *
+ */
+
+#ifndef UARRAY2F_INCLUDED
+#define UARRAY2F_INCLUDED
+
+#define T UArray2f_T
+typedef struct T *T;
+
+
+/**********UArray2f_new********
+ *
+ * Creates and returns a UArray2f
+ * Inputs: number of columns and number of rows and size of each element
+ * Return: A UArray2f of the designated dimensions with every element zeroed
+ * Expects:
+ *      Size to reflect the size of a single element of the desired data type
+ *      Width and height to be greater than or equal to 0
+ * Notes:
+ *      All elements are held in a single allocation
+ *
+ ************************/
+T UArray2f_new(int width, int height, int size);
+
+
+/**********UArray2f_free********
+ *
+ * Frees up all space allocated by a UArray2f
+ * Inputs: pointer to a UArray2f
+ * Return: nothing
+ * Expects: UArray2f to be nonnull and not freed already
+ *
+ * Notes: none
+ *
+ ************************/
+void UArray2f_free(T *array2f);
+
+
+/**********UArray2f_width / height / size / stride********
+ *
+ * Return the width, height, element size and row stride (in bytes)
+ * Inputs: the UArray2f
+ * Expects: UArray2f to be nonnull
+ *
+ * Notes: stride is the distance in bytes from an element to the one
+ *      directly below it
+ *
+ ************************/
+int UArray2f_width(T array2f);
+int UArray2f_height(T array2f);
+int UArray2f_size(T array2f);
+int UArray2f_stride(T array2f);
+
+
+/**********UArray2f_at********
+ *
+ * Finds the element stored at the given col/row
+ * Inputs: The UArray2f, the col, and the row of the element to be found
+ * Return: A void pointer pointing to the element at the given col/row
+ * Expects
+ *      The col/row parameters to be between 0 and the width/height of the
+ *      UArray2f - 1.
+ *      A nonnull UArray2f
+ * Notes:
+ *
+ ************************/
+void *UArray2f_at(T array2f, int col, int row);
+
+
+/**********UArray2f_map_row_major / UArray2f_map_col_major********
+ *
+ * Applies a function onto the elements one by one in row major or col
+ * major order
+ * Inputs: The UArray2f storing the elements, the function to apply, and a
+ *      void pointer indicating the closure of the apply function
+ * Return: nothing
+ * Expects:
+ *      Nonnull UArray2f
+ *      Working apply function
+ * Notes:
+ *      Both walk the slab with pointer increments; neither calls
+ *      UArray2f_at
+ *
+ ************************/
+void UArray2f_map_row_major(T array2f, void apply(int col, int row,
+                        T array2f, void *elem, void *cl), void *cl);
+void UArray2f_map_col_major(T array2f, void apply(int col, int row,
+                        T array2f, void *elem, void *cl), void *cl);
+
+
+/**********UArray2f_map_region********
+ *
+ * Like UArray2f_map_row_major, but visits only the width x height
+ * rectangle whose top left element is (col, row)
+ * Inputs: The UArray2f, the rectangle, the function to apply, and its
+ *      closure
+ * Return: nothing
+ * Expects:
+ *      Nonnull UArray2f, and a rectangle that lies inside it
+ * Notes:
+ *      apply gets each element's col/row relative to the rectangle, so
+ *      the rectangle's top left element is (0, 0)
+ *
+ ************************/
+void UArray2f_map_region(T array2f, int col, int row, int width, int height,
+                         void apply(int col, int row, T array2f, void *elem,
+                                    void *cl), void *cl);
+
+#undef T
+#endif
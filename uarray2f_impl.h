@@ -0,0 +1,35 @@
+/*
+ *     uarray2f_impl.h
+ *
+ *     locality
+ *
+ *     The representation of a UArray2f, for the modules (like the
+ *     ppmtrans kernels) that walk its slab directly instead of going
+ *     through UArray2f_at.
+ *
+ */
+
+#ifndef UARRAY2F_IMPL_INCLUDED
+#define UARRAY2F_IMPL_INCLUDED
+
+#include <stddef.h>
+#include "uarray2f.h"
+
+/*
+ * Element (i, j) lives at elems + j * stride + i * size. The slab is
+ * SLAB_ALIGN aligned so row 0 starts on a cache line.
+ */
+struct UArray2f_T {
+        int width, height;
+        int size;
+        int stride;     /* bytes from one row to the next */
+        char *elems;
+};
+
+/* first byte of row j */
+static inline char *UArray2f_rowstart(UArray2f_T a, int j)
+{
+        return a->elems + (size_t)j * a->stride;
+}
+
+#endif
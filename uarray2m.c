@@ -0,0 +1,214 @@
+/*
+ *     uarray2m.c
+ *
+ *     locality
+ *
+ *     This is the implementation file for our UArray2m interface.
+ *
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+
+#ifdef __BMI2__
+#include <immintrin.h>
+#endif
+
+#include "assert.h"
+#include "mem.h"
+#include "slab.h"
+#include "uarray2m.h"
+
+#define T UArray2m_T
+
+/* squares at least this big are mapped in LEAF x LEAF pieces */
+#define LEAF 8
+
+/*
+ * The shorter side is padded to a power of two, side = 1 << shift. The
+ * array is a line of side x side squares laid end to end (left to right
+ * if wide is set, top to bottom otherwise), each stored in Z-order with
+ * the column in the even bits and the row in the odd bits. Element
+ * (i, j) of square q is at q * side * side + interleave(i, j).
+ *
+ * Both sides can nearly double: the shorter one going up to a power of
+ * two, and the longer one up to a whole number of squares. So the worst
+ * case, a near-square array just past a power of two, allocates almost
+ * 4x its elements (1025x1025 takes 2048x2048). The longer side's
+ * padding is under one square, so long thin arrays stay nearer 2x.
+ */
+struct T {
+        int width, height;
+        int size;
+        int shift;
+        int wide;
+        int nsquares;
+        char *elems;
+};
+
+/* spreads the low 32 bits of x out to the even bits of the result */
+static inline uint64_t spread(uint64_t x)
+{
+#ifdef __BMI2__
+        return _pdep_u64(x, 0x5555555555555555ULL);
+#else
+        x &= 0xffffffffULL;
+        x = (x | (x << 16)) & 0x0000ffff0000ffffULL;
+        x = (x | (x << 8))  & 0x00ff00ff00ff00ffULL;
+        x = (x | (x << 4))  & 0x0f0f0f0f0f0f0f0fULL;
+        x = (x | (x << 2))  & 0x3333333333333333ULL;
+        x = (x | (x << 1))  & 0x5555555555555555ULL;
+        return x;
+#endif
+}
+
+/* inverse of spread: gathers the even bits of x */
+static inline uint32_t compact(uint64_t x)
+{
+#ifdef __BMI2__
+        return _pext_u64(x, 0x5555555555555555ULL);
+#else
+        x &= 0x5555555555555555ULL;
+        x = (x | (x >> 1))  & 0x3333333333333333ULL;
+        x = (x | (x >> 2))  & 0x0f0f0f0f0f0f0f0fULL;
+        x = (x | (x >> 4))  & 0x00ff00ff00ff00ffULL;
+        x = (x | (x >> 8))  & 0x0000ffff0000ffffULL;
+        x = (x | (x >> 16)) & 0x00000000ffffffffULL;
+        return x;
+#endif
+}
+
+static inline size_t square_elems(T a)
+{
+        return (size_t)1 << (2 * a->shift);
+}
+
+static inline size_t slab_bytes(T a)
+{
+        return square_elems(a) * a->nsquares * a->size;
+}
+
+T UArray2m_new(int width, int height, int size)
+{
+        assert(width > 0 && height > 0);
+        assert(size > 0);
+        T array;
+        NEW(array);
+        array->width  = width;
+        array->height = height;
+        array->size   = size;
+        array->wide   = width >= height;
+
+        int shorter = array->wide ? height : width;
+        int longer  = array->wide ? width : height;
+        assert(shorter <= (1 << 30));    /* side must fit in an int */
+        array->shift = 0;
+        while ((1 << array->shift) < shorter) {
+                array->shift++;
+        }
+        int side = 1 << array->shift;
+        array->nsquares = (longer - 1) / side + 1;
+
+        /* padding can make this up to 4x width * height * size bytes */
+        assert(square_elems(array) <= SIZE_MAX / size / array->nsquares);
+        array->elems = Slab_alloc(slab_bytes(array));
+        return array;
+}
+
+void UArray2m_free(T *array2m)
+{
+        assert(array2m != NULL && *array2m != NULL);
+        Slab_free((*array2m)->elems, slab_bytes(*array2m));
+        FREE(*array2m);
+}
+
+int UArray2m_width(T array2m)
+{
+        assert(array2m != NULL);
+        return array2m->width;
+}
+
+int UArray2m_height(T array2m)
+{
+        assert(array2m != NULL);
+        return array2m->height;
+}
+
+int UArray2m_size(T array2m)
+{
+        assert(array2m != NULL);
+        return array2m->size;
+}
+
+void *UArray2m_at(T array2m, int i, int j)
+{
+        assert(array2m != NULL);
+        assert(i >= 0 && i < array2m->width);
+        assert(j >= 0 && j < array2m->height);
+
+        int shift = array2m->shift;
+        unsigned low = (1u << shift) - 1;
+
+        /* only the longer side has bits above the square */
+        size_t square = array2m->wide ? (unsigned)i >> shift
+                                      : (unsigned)j >> shift;
+        size_t index = (square << (2 * shift))
+                     | spread(i & low) | (spread(j & low) << 1);
+        return array2m->elems + index * array2m->size;
+}
+
+/*
+ * Visits the side x side Z-ordered square whose top left is (x0, y0) and
+ * whose first element is at elem, skipping quarters that are all padding
+ */
+static void map_square(T array2m, int x0, int y0, int side, char *elem,
+                       void apply(int i, int j, T array2m, 
+                                  void *elem, void *cl),
+                       void *cl)
+{
+        int w = array2m->width;
+        int h = array2m->height;
+        int size = array2m->size;
+
+        if (x0 >= w || y0 >= h) {
+                return;
+        }
+        if (side <= LEAF) {
+                int n = side * side;
+                for (int k = 0; k < n; k++, elem += size) {
+                        int i = x0 + compact(k);
+                        int j = y0 + compact(k >> 1);
+                        if (i < w && j < h) {
+                                apply(i, j, array2m, elem, cl);
+                        }
+                }
+                return;
+        }
+
+        int half = side / 2;
+        size_t quarter = (size_t)half * half * size;
+        map_square(array2m, x0,        y0,        half, elem, apply, cl);
+        map_square(array2m, x0 + half, y0,        half, elem + quarter, 
+                   apply, cl);
+        map_square(array2m, x0,        y0 + half, half, elem + 2 * quarter,
+                   apply, cl);
+        map_square(array2m, x0 + half, y0 + half, half, elem + 3 * quarter,
+                   apply, cl);
+}
+
+void UArray2m_map(T array2m, 
+                  void apply(int i, int j, T array2m, void *elem, void *cl),
+                  void *cl)
+{
+        assert(array2m != NULL);
+        assert(apply != NULL);
+        int side = 1 << array2m->shift;
+        size_t squarebytes = square_elems(array2m) * array2m->size;
+        for (int q = 0; q < array2m->nsquares; q++) {
+                int x0 = array2m->wide ? q * side : 0;
+                int y0 = array2m->wide ? 0 : q * side;
+                map_square(array2m, x0, y0, side, 
+                           array2m->elems + q * squarebytes, apply, cl);
+        }
+}
+#undef T
@@ -0,0 +1,97 @@
+/*
+ *     uarray2m.h
+ *
+ *     locality
+ *
+ *     This is the header file for the UArray2m interface, a 2D array
+ *     stored in Morton (Z-order): the bits of the column and row are
+ *     interleaved to find an element's position, so elements that are
+ *     close in either direction are close in memory at every scale.
+ *
+ */
+
+#ifndef UARRAY2M_INCLUDED
+#define UARRAY2M_INCLUDED
+
+#define T UArray2m_T
+typedef struct T *T;
+
+
+/**********UArray2m_new********
+ *
+ * Creates and returns a UArray2m
+ * Inputs: number of columns and number of rows and size of each element
+ * Return: A UArray2m of the designated dimensions with every element zeroed
+ * Expects:
+ *      Size to reflect the size of a single element of the desired data type
+ *      Width and height to be greater than 0
+ * Notes:
+ *      The shorter side is padded up to a power of two, s, and the array
+ *      is stored as a row (or column) of s x s Z-ordered squares, so both
+ *      sides may nearly double: up to about 4x the elements are allocated
+ *      for a near-square array just past a power of two (1025x1025 takes
+ *      2048x2048). It is a checked runtime error for the padded array not
+ *      to fit in a size_t. Padding is never mapped
+ *
+ ************************/
+T UArray2m_new(int width, int height, int size);
+
+
+/**********UArray2m_free********
+ *
+ * Frees up all space allocated by a UArray2m
+ * Inputs: pointer to a UArray2m
+ * Return: nothing
+ * Expects: UArray2m to be nonnull and not freed already
+ *
+ ************************/
+void UArray2m_free(T *array2m);
+
+
+/**********UArray2m_width / height / size********
+ *
+ * Return the width, height and element size of a UArray2m
+ * Inputs: the UArray2m
+ * Expects: UArray2m to be nonnull
+ *
+ ************************/
+int UArray2m_width(T array2m);
+int UArray2m_height(T array2m);
+int UArray2m_size(T array2m);
+
+
+/**********UArray2m_at********
+ *
+ * Finds the element stored at the given col/row
+ * Inputs: The UArray2m, the col, and the row of the element to be found
+ * Return: A void pointer pointing to the element at the given col/row
+ * Expects
+ *      The col/row parameters to be between 0 and the width/height of the
+ *      UArray2m - 1.
+ *      A nonnull UArray2m
+ * Notes:
+ *      Uses PDEP to interleave the bits when compiled for BMI2
+ *
+ ************************/
+void *UArray2m_at(T array2m, int col, int row);
+
+
+/**********UArray2m_map********
+ *
+ * Applies a function onto the elements one by one in Z-order
+ * Inputs: The UArray2m storing the elements, the function to apply, and a
+ *      void pointer indicating the closure of the apply function
+ * Return: nothing
+ * Expects:
+ *      Nonnull UArray2m
+ *      Working apply function
+ * Notes:
+ *      This is the order the elements are stored in, so the map walks
+ *      memory sequentially, skipping only padding
+ *
+ ************************/
+void UArray2m_map(T array2m, void apply(int col, int row, T array2m,
+                                        void *elem, void *cl), void *cl);
+
+#undef T
+#endif